@@ -0,0 +1,948 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "IKChain.h"
+#include "IKPoseCache.h"
+#include "IKReachabilityMap.h"
+#include "IKBatchSolver.h"
+#include "IKTaskScheduler.h"
+#include "IKJobScheduler.h"
+#include "IKSimd.h"
+
+// Benchmark parameters, the chain matches the viewer's chain.
+static const float LINK_LENGTH = 4.0f;
+static const int MAX_SOLVE_ITERATIONS = 100;
+static const float SOLVE_TOLERANCE = 0.1f;
+static const int DEFAULT_NUM_OF_SOLVES = 10000;
+static const int DEFAULT_NUM_OF_LINKS = 6;
+
+// Boundary targets distance from the base, relative to the chain's length.
+static const float BOUNDARY_MIN_DISTANCE = 0.9f;
+static const float BOUNDARY_MAX_DISTANCE = 0.98f;
+
+// The scalar solvers to compare.
+static const IKSolverType SCALAR_SOLVER_TYPES[] = { IK_SOLVER_CCD, IK_SOLVER_FABRIK, IK_SOLVER_JACOBIAN_TRANSPOSE, IK_SOLVER_JACOBIAN_DLS, IK_SOLVER_JACOBI_CCD };
+static const char* SCALAR_SOLVER_NAMES[] = { "IKChain CCD", "IKChain FABRIK", "IKChain Jacobian transpose", "IKChain Jacobian DLS", "IKChain Jacobi CCD" };
+static const int NUM_OF_SCALAR_SOLVERS = sizeof(SCALAR_SOLVER_TYPES) / sizeof(SCALAR_SOLVER_TYPES[0]);
+
+// Standard targets for the CCD step policies, relative to the chain's base and length.
+static const vec3 STANDARD_TARGETS[] = { vec3(0.25f, 0, 0.25f), vec3(0.5f, 0.2f, 0.3f), vec3(0, 0.9f, 0.2f), vec3(0.97f, 0, 0.1f), vec3(-0.3f, -0.3f, -0.5f), vec3(0.1f, 0.1f, 0.05f) };
+static const char* STANDARD_TARGET_NAMES[] = { "near", "middle", "far", "boundary", "below", "at the base" };
+static const int NUM_OF_STANDARD_TARGETS = sizeof(STANDARD_TARGETS) / sizeof(STANDARD_TARGETS[0]);
+
+// Check mode, targets every iterative solver must converge on from the straight pose within the iterations budget,
+// relative to the chain's base and length, and how far a reported residual may be from the chain's actual distance to the target.
+static const vec3 CHECK_TARGETS[] = { vec3(0.5f, 0.2f, 0.3f), vec3(-0.3f, -0.3f, -0.5f), vec3(0.1f, 0.1f, 0.05f), vec3(0.3f, 0.6f, -0.2f), vec3(-0.6f, 0.2f, 0.1f), vec3(0.2f, -0.7f, 0.3f) };
+static const int NUM_OF_CHECK_TARGETS = sizeof(CHECK_TARGETS) / sizeof(CHECK_TARGETS[0]);
+static const float CHECK_RESIDUAL_EPSILON = 1e-3f;
+// How far the solvers' rotation quaternions may drift from unit length.
+static const float CHECK_UNIT_EPSILON = 1e-4f;
+
+// Out of reach targets distance from the base, relative to the chain's length.
+static const float OUT_OF_REACH_MIN_DISTANCE = 1.2f;
+static const float OUT_OF_REACH_MAX_DISTANCE = 2.0f;
+
+// Animation loop targets, samples per loop around the base, the loop's radius relative to the chain's length,
+// the jitter between loops, and the pose cache's parameters.
+static const int ANIMATION_LOOP_SAMPLES = 64;
+static const float ANIMATION_LOOP_RADIUS = 0.6f;
+static const float ANIMATION_LOOP_JITTER = 0.05f;
+static const int POSE_CACHE_CAPACITY = 128;
+static const float POSE_CACHE_CELL_SIZE = 0.5f;
+
+// Long chains for sequential against Jacobi CCD, their lengths and the number of solves of each.
+static const int LONG_CHAIN_LENGTHS[] = { 16, 64, 256, 1024, 4096 };
+static const int NUM_OF_LONG_CHAIN_LENGTHS = sizeof(LONG_CHAIN_LENGTHS) / sizeof(LONG_CHAIN_LENGTHS[0]);
+static const int LONG_CHAIN_SOLVES = 20;
+
+// Multi-resolution against flat solves, the chain's length and the number of solves.
+static const int MULTIRES_NUM_OF_LINKS = 512;
+static const int MULTIRES_SOLVES = 20;
+
+// Anytime solves, the chain's length, the number of solves and the time budgets in microseconds.
+static const int ANYTIME_NUM_OF_LINKS = 128;
+static const int ANYTIME_SOLVES = 50;
+static const int ANYTIME_BUDGETS[] = { 50, 200, 1000, 5000 };
+static const int NUM_OF_ANYTIME_BUDGETS = sizeof(ANYTIME_BUDGETS) / sizeof(ANYTIME_BUDGETS[0]);
+// From this budget in microseconds no solve may return late, below it a single residual or pose copy is a fair part of the budget.
+static const int ANYTIME_MIN_CHECKED_BUDGET = 200;
+
+// Mixed priority jobs, the critical and background chains, the frames, the IK budget of every frame and the number
+// of frames a background job may lag.
+static const int JOB_NUM_OF_CRITICAL_CHAINS = 4;
+static const int JOB_NUM_OF_BACKGROUND_CHAINS = 60;
+static const int JOB_NUM_OF_LINKS = 16;
+static const int JOB_NUM_OF_FRAMES = 60;
+static const int JOB_FRAME_BUDGET_MICROSECONDS = 2000;
+static const int JOB_BACKGROUND_LAG_FRAMES = 4;
+
+// Reachability map build mode, the default resolution and the viewer's chain end effector offset.
+static const int DEFAULT_REACHABILITY_RESOLUTION = 32;
+static const vec3 VIEWER_END_EFFECTOR_OFFSET = vec3(1, 1, 0);
+
+// The original viewer's fixed CCD damping.
+static const int ORIGINAL_ANGLE_SIZE_FACTOR = 25;
+
+/*
+* randomReachablePoint
+*
+* @tbrief A uniformly distributed random point inside the sphere the chain can reach.
+*/
+static vec3 randomReachablePoint(std::mt19937& generator, vec3 center, float radius)
+{
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	vec3 point;
+	do
+	{
+		point = vec3(distribution(generator), distribution(generator), distribution(generator));
+	} while (length(point) > 1.0f);
+
+	return center + point * radius;
+}
+
+/*
+* randomBoundaryPoint
+*
+* @tbrief A random point near the edge of the sphere the chain can reach, where the chain is almost straight.
+*/
+static vec3 randomBoundaryPoint(std::mt19937& generator, vec3 center, float radius)
+{
+	std::uniform_real_distribution<float> distance(BOUNDARY_MIN_DISTANCE, BOUNDARY_MAX_DISTANCE);
+	vec3 direction;
+	do
+	{
+		direction = randomReachablePoint(generator, vec3(0), 1.0f);
+	} while (length(direction) < 1e-3f);
+
+	return center + normalize(direction) * radius * distance(generator);
+}
+
+/*
+* printResults
+*
+* @tbrief Print the summary of a set of solves.
+*/
+static void printResults(const char* name, const std::vector<IKSolveResult>& results, double seconds)
+{
+	int totalIterations = 0;
+	int numOfConverged = 0;
+	float totalResidual = 0;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		totalIterations += results[i].iterations;
+		totalResidual += results[i].residual;
+		numOfConverged += (results[i].residual <= SOLVE_TOLERANCE);
+	}
+
+	std::cout << name << std::endl;
+	std::cout << "  Converged:           " << numOfConverged << " / " << results.size() << std::endl;
+	std::cout << "  Average iterations:  " << totalIterations / (float)results.size() << std::endl;
+	std::cout << "  Average residual:    " << totalResidual / results.size() << std::endl;
+	std::cout << "  Total time:          " << seconds << "s" << std::endl;
+	std::cout << "  Solves per second:   " << results.size() / seconds << std::endl;
+}
+
+/*
+* solveChainByChain
+*
+* @tbrief Solve all the targets one at a time from the straight pose with a single IKChain.
+* @treturn The total time in seconds.
+*/
+static double solveChainByChain(IKChain& chain, IKSolverType solverType, const std::vector<vec3>& targets, std::vector<IKSolveResult>& results)
+{
+	chain.setSolverType(solverType);
+	auto startTime = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < targets.size(); i++)
+	{
+		chain.reset();
+		results[i] = chain.solve(targets[i], MAX_SOLVE_ITERATIONS, SOLVE_TOLERANCE);
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+/*
+* printStepPolicies
+*
+* @tbrief Print the CCD iterations to converge on the standard targets with every step policy, unconverged solves are marked with *.
+*/
+static void printStepPolicies(int numOfLinks)
+{
+	static const char* policyNames[] = { "fixed 1/25", "fixed 1/1", "adaptive", "adaptive stiff base" };
+	static const int numOfPolicies = sizeof(policyNames) / sizeof(policyNames[0]);
+
+	IKChain chain(numOfLinks, vec3(0), LINK_LENGTH);
+	chain.setAnalyticEnabled(false);
+
+	std::cout << "CCD step policies, iterations to converge" << std::endl << std::setw(14) << "";
+	for (int j = 0; j < numOfPolicies; j++)
+	{
+		std::cout << std::setw(21) << policyNames[j];
+	}
+	std::cout << std::endl;
+
+	for (int i = 0; i < NUM_OF_STANDARD_TARGETS; i++)
+	{
+		std::cout << "  " << std::left << std::setw(12) << STANDARD_TARGET_NAMES[i] << std::right;
+		vec3 target = chain.getBasePosition() + STANDARD_TARGETS[i] * chain.getMaxLength();
+		for (int j = 0; j < numOfPolicies; j++)
+		{
+			chain.setStepPolicy((j < 2) ? IK_STEP_FIXED : IK_STEP_ADAPTIVE);
+			chain.setAngleSizeFactor((j == 0) ? ORIGINAL_ANGLE_SIZE_FACTOR : 1);
+			chain.setJointStiffness(IK_BASE_LINK_INDEX, (j == 3) ? 0.5f : 0.0f);
+
+			chain.reset();
+			IKSolveResult result = chain.solve(target, MAX_SOLVE_ITERATIONS, SOLVE_TOLERANCE);
+			std::cout << std::setw(20) << result.iterations << ((result.residual <= SOLVE_TOLERANCE) ? " " : "*");
+		}
+		std::cout << std::endl;
+	}
+}
+
+/*
+* solveAnimationLoop
+*
+* @tbrief Solve the targets in order without resetting the chain, every solve starts from the previous pose
+* or from the pose cache when it's given.
+* @treturn The total time in seconds.
+*/
+static double solveAnimationLoop(IKChain& chain, IKPoseCache* poseCache, const std::vector<vec3>& targets, std::vector<IKSolveResult>& results)
+{
+	chain.setSolverType(IK_SOLVER_CCD);
+	chain.reset();
+	auto startTime = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < targets.size(); i++)
+	{
+		results[i] = poseCache ? poseCache->solve(chain, targets[i], MAX_SOLVE_ITERATIONS, SOLVE_TOLERANCE) : chain.solve(targets[i], MAX_SOLVE_ITERATIONS, SOLVE_TOLERANCE);
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+/*
+* printLongChains
+*
+* @tbrief Sequential CCD against Jacobi CCD on a single thread and on all the cores, for chains of growing lengths.
+*/
+static void printLongChains(IKTaskScheduler& scheduler)
+{
+	std::mt19937 generator(1234);
+	for (int i = 0; i < NUM_OF_LONG_CHAIN_LENGTHS; i++)
+	{
+		IKChain longChain(LONG_CHAIN_LENGTHS[i], vec3(0), LINK_LENGTH);
+		longChain.setMultiResolutionEnabled(false);
+		std::vector<vec3> longTargets(LONG_CHAIN_SOLVES);
+		for (int j = 0; j < LONG_CHAIN_SOLVES; j++)
+		{
+			longTargets[j] = randomReachablePoint(generator, longChain.getBasePosition(), longChain.getMaxLength());
+		}
+
+		std::vector<IKSolveResult> longResults(LONG_CHAIN_SOLVES);
+		std::cout << "[" << LONG_CHAIN_LENGTHS[i] << " links] ";
+		printResults("IKChain CCD", longResults, solveChainByChain(longChain, IK_SOLVER_CCD, longTargets, longResults));
+
+		std::cout << "[" << LONG_CHAIN_LENGTHS[i] << " links] ";
+		printResults("IKChain Jacobi CCD", longResults, solveChainByChain(longChain, IK_SOLVER_JACOBI_CCD, longTargets, longResults));
+
+		if (LONG_CHAIN_LENGTHS[i] >= IK_JACOBI_PARALLEL_MIN_LINKS)
+		{
+			longChain.setTaskScheduler(&scheduler);
+			std::cout << "[" << LONG_CHAIN_LENGTHS[i] << " links] ";
+			printResults("IKChain Jacobi CCD + IKTaskScheduler", longResults, solveChainByChain(longChain, IK_SOLVER_JACOBI_CCD, longTargets, longResults));
+		}
+	}
+}
+
+/*
+* printMultiResolution
+*
+* @tbrief Flat CCD against a multi-resolution solve refined by CCD, from the straight pose of a long chain.
+*/
+static void printMultiResolution()
+{
+	std::mt19937 generator(4321);
+	IKChain chain(MULTIRES_NUM_OF_LINKS, vec3(0), LINK_LENGTH);
+	std::vector<vec3> multiResTargets(MULTIRES_SOLVES);
+	for (int i = 0; i < MULTIRES_SOLVES; i++)
+	{
+		multiResTargets[i] = randomReachablePoint(generator, chain.getBasePosition(), chain.getMaxLength());
+	}
+
+	std::vector<IKSolveResult> multiResResults(MULTIRES_SOLVES);
+	std::cout << "[" << MULTIRES_NUM_OF_LINKS << " links] ";
+	chain.setMultiResolutionEnabled(false);
+	printResults("IKChain CCD", multiResResults, solveChainByChain(chain, IK_SOLVER_CCD, multiResTargets, multiResResults));
+
+	std::cout << "[" << MULTIRES_NUM_OF_LINKS << " links] ";
+	chain.setMultiResolutionEnabled(true);
+	printResults("IKChain multi-resolution + CCD", multiResResults, solveChainByChain(chain, IK_SOLVER_CCD, multiResTargets, multiResResults));
+}
+
+/*
+* printAnytimeBudgets
+*
+* @tbrief Print the average residual and iterations of deadline solves with every time budget, and the number
+* of solves that returned after their deadline, with CCD and with FABRIK.
+* @treturn false if a solve with a budget from ANYTIME_MIN_CHECKED_BUDGET up returned late.
+*/
+static bool printAnytimeBudgets()
+{
+	static const IKSolverType solverTypes[] = { IK_SOLVER_CCD, IK_SOLVER_FABRIK, IK_SOLVER_JACOBIAN_TRANSPOSE, IK_SOLVER_JACOBIAN_DLS };
+	static const char* solverNames[] = { "CCD", "FABRIK", "Jacobian transpose", "Jacobian DLS" };
+
+	std::mt19937 generator(2468);
+	IKChain chain(ANYTIME_NUM_OF_LINKS, vec3(0), LINK_LENGTH);
+	std::vector<vec3> anytimeTargets(ANYTIME_SOLVES);
+	for (int i = 0; i < ANYTIME_SOLVES; i++)
+	{
+		anytimeTargets[i] = randomReachablePoint(generator, chain.getBasePosition(), chain.getMaxLength());
+	}
+
+	bool isPassed = true;
+	std::cout << "[" << ANYTIME_NUM_OF_LINKS << " links] Anytime solves, average residual / iterations / late returns" << std::endl;
+	for (int j = 0; j < 2; j++)
+	{
+		chain.setSolverType(solverTypes[j]);
+		for (int k = 0; k < NUM_OF_ANYTIME_BUDGETS; k++)
+		{
+			float totalResidual = 0;
+			int totalIterations = 0;
+			int numOfLateReturns = 0;
+			for (int i = 0; i < ANYTIME_SOLVES; i++)
+			{
+				chain.reset();
+				IKClock::time_point deadline = IKClock::now() + std::chrono::microseconds(ANYTIME_BUDGETS[k]);
+				IKSolveResult result = chain.solveUntil(anytimeTargets[i], deadline, SOLVE_TOLERANCE);
+				bool isLate = (IKClock::now() > deadline);
+
+				// The benchmark being preempted makes a solve late as well, run it again, a preemption doesn't repeat but a mispredicted step does.
+				if (isLate)
+				{
+					chain.reset();
+					deadline = IKClock::now() + std::chrono::microseconds(ANYTIME_BUDGETS[k]);
+					chain.solveUntil(anytimeTargets[i], deadline, SOLVE_TOLERANCE);
+					isLate = (IKClock::now() > deadline);
+				}
+				numOfLateReturns += isLate ? 1 : 0;
+				totalResidual += result.residual;
+				totalIterations += result.iterations;
+			}
+			std::cout << "  " << std::left << std::setw(8) << solverNames[j] << std::right << std::setw(6) << ANYTIME_BUDGETS[k] << "us"
+				<< std::setw(12) << totalResidual / ANYTIME_SOLVES << std::setw(10) << float(totalIterations) / ANYTIME_SOLVES
+				<< std::setw(10) << numOfLateReturns << " / " << ANYTIME_SOLVES << std::endl;
+			if ((numOfLateReturns > 0) && (ANYTIME_BUDGETS[k] >= ANYTIME_MIN_CHECKED_BUDGET))
+			{
+				std::cout << "  FAILED, " << solverNames[j] << " solves returned after a " << ANYTIME_BUDGETS[k] << "us deadline" << std::endl;
+				isPassed = false;
+			}
+		}
+	}
+	return isPassed;
+}
+
+/*
+* printJobScheduler
+*
+* @tbrief Simulate frames of critical chains that must finish every frame and background chains that may lag, every chain
+* gets a new random target once its previous job is done, and print the completed jobs and the misses of every priority.
+* @treturn false if critical jobs are still queued after the last frame, a critical chain must never be left behind.
+*/
+static bool printJobScheduler()
+{
+	static const int numOfChains = JOB_NUM_OF_CRITICAL_CHAINS + JOB_NUM_OF_BACKGROUND_CHAINS;
+	static const char* priorityNames[] = { "background", "normal", "critical" };
+
+	std::mt19937 generator(1357);
+	std::vector<IKChain> chains(numOfChains, IKChain(JOB_NUM_OF_LINKS, vec3(0), LINK_LENGTH));
+	std::vector<IKSolveJob> jobs(numOfChains);
+	for (int i = 0; i < numOfChains; i++)
+	{
+		jobs[i].chain = &chains[i];
+		jobs[i].maxIterations = MAX_SOLVE_ITERATIONS;
+		jobs[i].tolerance = SOLVE_TOLERANCE;
+		jobs[i].priority = (i < JOB_NUM_OF_CRITICAL_CHAINS) ? IK_JOB_PRIORITY_CRITICAL : IK_JOB_PRIORITY_BACKGROUND;
+		jobs[i].isDone = true;
+	}
+
+	IKJobScheduler scheduler(numOfChains);
+	std::chrono::microseconds frameBudget(JOB_FRAME_BUDGET_MICROSECONDS);
+	for (int frame = 0; frame < JOB_NUM_OF_FRAMES; frame++)
+	{
+		IKClock::time_point frameStart = IKClock::now();
+		for (int i = 0; i < numOfChains; i++)
+		{
+			if (jobs[i].isDone)
+			{
+				jobs[i].targetPoint = randomReachablePoint(generator, chains[i].getBasePosition(), chains[i].getMaxLength());
+				jobs[i].deadline = frameStart + frameBudget * ((jobs[i].priority == IK_JOB_PRIORITY_CRITICAL) ? 1 : JOB_BACKGROUND_LAG_FRAMES);
+				scheduler.submit(&jobs[i]);
+			}
+		}
+		scheduler.runUntil(frameStart + frameBudget);
+	}
+
+	std::cout << "IKJobScheduler, " << JOB_NUM_OF_FRAMES << " frames of " << JOB_FRAME_BUDGET_MICROSECONDS << "us on " << scheduler.getNumOfWorkers() << " workers, "
+		<< JOB_NUM_OF_CRITICAL_CHAINS << " critical and " << JOB_NUM_OF_BACKGROUND_CHAINS << " background chains of " << JOB_NUM_OF_LINKS << " links" << std::endl;
+	for (int priority = IK_JOB_PRIORITY_CRITICAL; priority >= IK_JOB_PRIORITY_BACKGROUND; priority -= 2)
+	{
+		std::cout << "  " << std::left << std::setw(12) << priorityNames[priority] << std::right << "completed: " << std::setw(6) << scheduler.getNumOfCompletedJobs((IKJobPriority)priority)
+			<< "  missed: " << std::setw(6) << scheduler.getNumOfMisses((IKJobPriority)priority) << std::endl;
+	}
+
+	// The longest a queued job has been waiting to run, aging bounds how long a job can be starved.
+	IKClock::time_point now = IKClock::now();
+	IKClock::duration longestWait = IKClock::duration::zero();
+	int numOfQueuedCritical = 0;
+	for (int i = 0; i < numOfChains; i++)
+	{
+		if (!jobs[i].isDone)
+		{
+			longestWait = std::max(longestWait, now - jobs[i].waitingSince);
+			numOfQueuedCritical += (jobs[i].priority == IK_JOB_PRIORITY_CRITICAL) ? 1 : 0;
+		}
+	}
+	std::cout << "  Preemptions: " << scheduler.getNumOfPreemptions() << ", still queued: " << scheduler.getNumOfQueuedJobs()
+		<< ", longest wait: " << std::chrono::duration_cast<std::chrono::microseconds>(longestWait).count() << "us" << std::endl;
+
+	if (numOfQueuedCritical > 0)
+	{
+		std::cout << "  FAILED, critical jobs still queued: " << numOfQueuedCritical << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/*
+* buildReachabilityMap
+*
+* @tbrief Build mode, build the reachability map of the viewer's chain, then compare solving random targets in the map's grid
+* with the map (O(1) reachability and seeded solves) against the sphere test and solves from the straight pose.
+* Usage: IKBenchmark --build-reachability <path> [numOfLinks] [resolution] [numOfSolves]
+*/
+static int buildReachabilityMap(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::cout << "Usage: IKBenchmark --build-reachability <path> [numOfLinks] [resolution] [numOfSolves]" << std::endl;
+		return 1;
+	}
+	const char* path = argv[2];
+	int numOfLinks = (argc > 3) ? atoi(argv[3]) : DEFAULT_NUM_OF_LINKS;
+	int resolution = (argc > 4) ? atoi(argv[4]) : DEFAULT_REACHABILITY_RESOLUTION;
+	int numOfSolves = (argc > 5) ? atoi(argv[5]) : DEFAULT_NUM_OF_SOLVES;
+
+	// The viewer's chain, built with FABRIK that converges everywhere the chain can reach.
+	IKChain chain(numOfLinks, vec3(0), LINK_LENGTH);
+	chain.setEndEffectorOffset(VIEWER_END_EFFECTOR_OFFSET);
+	chain.setAnalyticEnabled(false);
+	chain.setSolverType(IK_SOLVER_FABRIK);
+
+	std::cout << "Building " << path << ", links: " << numOfLinks << ", resolution: " << resolution << std::endl;
+	auto startTime = std::chrono::steady_clock::now();
+	if (!IKReachabilityMap::build(chain, resolution, MAX_SOLVE_ITERATIONS, path))
+	{
+		std::cout << "Failed writing " << path << std::endl;
+		return 1;
+	}
+	std::cout << "  Build time:          " << std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() << "s" << std::endl;
+
+	IKReachabilityMap map;
+	if (!map.open(path) || !map.matches(chain))
+	{
+		std::cout << "Failed mapping " << path << std::endl;
+		return 1;
+	}
+
+	// Random targets all over the map's grid, reachable or not.
+	std::mt19937 generator(1234);
+	float extent = chain.getMaxLength() + length(VIEWER_END_EFFECTOR_OFFSET);
+	std::uniform_real_distribution<float> distribution(-extent, extent);
+	std::vector<vec3> targets(numOfSolves);
+	int numOfReachable = 0;
+	for (int i = 0; i < numOfSolves; i++)
+	{
+		targets[i] = chain.getBasePosition() + vec3(distribution(generator), distribution(generator), distribution(generator));
+		numOfReachable += map.isReachable(chain.getBasePosition(), targets[i]);
+	}
+	std::cout << "  Reachable targets:   " << numOfReachable << " / " << numOfSolves << std::endl;
+
+	// The sphere test and solves from the straight pose.
+	chain.setSolverType(IK_SOLVER_CCD);
+	std::vector<IKSolveResult> results(numOfSolves);
+	printResults("[reachability] IKChain CCD", results, solveChainByChain(chain, IK_SOLVER_CCD, targets, results));
+
+	// The map's lookup and seeded solves, unreachable targets aren't solved at all.
+	startTime = std::chrono::steady_clock::now();
+	for (int i = 0; i < numOfSolves; i++)
+	{
+		chain.reset();
+		if (!map.isReachable(chain.getBasePosition(), targets[i]))
+		{
+			results[i].iterations = 0;
+			results[i].residual = distance(targets[i], chain.getEndEffectorPoint());
+			results[i].isReachable = false;
+			continue;
+		}
+		map.warmStart(chain, targets[i]);
+		results[i] = chain.solve(targets[i], MAX_SOLVE_ITERATIONS, SOLVE_TOLERANCE);
+	}
+	printResults("[reachability] IKChain CCD + IKReachabilityMap", results, std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+	return 0;
+}
+
+/*
+* checkConverged
+*
+* @tbrief Check a solve of a reachable target converged within the iterations budget and reported the chain's actual
+* distance from the target, print the solve if it didn't.
+* @treturn true if the check passed.
+*/
+static bool checkConverged(const char* name, IKChain& chain, vec3 target, IKSolveResult result)
+{
+	float actualResidual = distance(target, chain.getEndEffectorPoint());
+	if (result.isReachable && (result.residual <= SOLVE_TOLERANCE) && (result.iterations <= MAX_SOLVE_ITERATIONS) &&
+		(abs(actualResidual - result.residual) <= CHECK_RESIDUAL_EPSILON))
+	{
+		return true;
+	}
+
+	std::cout << "  FAILED " << name << ": residual " << result.residual << " (actually " << actualResidual << ") after "
+		<< result.iterations << " iterations, target " << target.x << ", " << target.y << ", " << target.z << std::endl;
+	return false;
+}
+
+/*
+* checkUnitRotations
+*
+* @tbrief Check every link's rotation is still a unit quaternion after a solve, print the first one that isn't.
+* @treturn true if the check passed.
+*/
+static bool checkUnitRotations(const char* name, IKChain& chain)
+{
+	for (int i = IK_BASE_LINK_INDEX; i < chain.getNumOfLinks(); i++)
+	{
+		float rotationLength = length(chain.getLinkRotation(i));
+		if (abs(rotationLength - 1.0f) > CHECK_UNIT_EPSILON)
+		{
+			std::cout << "  FAILED " << name << ": link " << i << " rotation's length is " << rotationLength << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+* checkForwardKinematics
+*
+* @tbrief Check the chain's incrementally updated joints against a chain with the same rotations whose forward kinematics
+* are calculated from scratch, print the first joint that differs.
+* @treturn true if the check passed.
+*/
+static bool checkForwardKinematics(const char* name, IKChain& chain)
+{
+	IKChain freshChain(chain.getNumOfLinks(), chain.getBasePosition(), chain.getLinkLength());
+	freshChain.setEndEffectorOffset(chain.getEndEffectorOffset());
+	for (int i = IK_BASE_LINK_INDEX; i < chain.getNumOfLinks(); i++)
+	{
+		freshChain.setLinkRotation(i, chain.getLinkRotation(i));
+	}
+
+	for (int i = IK_BASE_LINK_INDEX; i <= chain.getNumOfLinks(); i++)
+	{
+		vec3 point = (i < chain.getNumOfLinks()) ? chain.getLinkBottomPoint(i) : chain.getEndEffectorPoint();
+		vec3 freshPoint = (i < chain.getNumOfLinks()) ? freshChain.getLinkBottomPoint(i) : freshChain.getEndEffectorPoint();
+		if (distance(point, freshPoint) > CHECK_RESIDUAL_EPSILON)
+		{
+			std::cout << "  FAILED " << name << ": joint " << i << " is " << distance(point, freshPoint) << " away from its recalculated position" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+* checkSolvers
+*
+* @tbrief Solve the check targets from the straight pose with every iterative solver.
+* @treturn true if every solve converged and left unit rotations and up to date forward kinematics.
+*/
+static bool checkSolvers()
+{
+	static const IKSolverType solverTypes[] = { IK_SOLVER_CCD, IK_SOLVER_FABRIK, IK_SOLVER_JACOBIAN_TRANSPOSE, IK_SOLVER_JACOBIAN_DLS };
+	static const char* solverNames[] = { "CCD", "FABRIK", "Jacobian transpose", "Jacobian DLS" };
+	static const int numOfSolvers = sizeof(solverTypes) / sizeof(solverTypes[0]);
+
+	bool isPassed = true;
+	IKChain chain(DEFAULT_NUM_OF_LINKS, vec3(0), LINK_LENGTH);
+	chain.setAnalyticEnabled(false);
+	for (int i = 0; i < numOfSolvers; i++)
+	{
+		chain.setSolverType(solverTypes[i]);
+		for (int j = 0; j < NUM_OF_CHECK_TARGETS; j++)
+		{
+			chain.reset();
+			vec3 target = chain.getBasePosition() + CHECK_TARGETS[j] * chain.getMaxLength();
+			IKSolveResult result = chain.solve(target, MAX_SOLVE_ITERATIONS, SOLVE_TOLERANCE);
+			isPassed = checkConverged(solverNames[i], chain, target, result) && isPassed;
+			isPassed = checkUnitRotations(solverNames[i], chain) && isPassed;
+			isPassed = checkForwardKinematics(solverNames[i], chain) && isPassed;
+		}
+	}
+	return isPassed;
+}
+
+/*
+* checkAnalyticSolves
+*
+* @tbrief Solve the check targets with the closed form solve of the short chains, they must be reached exactly in a single step.
+* @treturn true if every solve reached its target.
+*/
+static bool checkAnalyticSolves()
+{
+	bool isPassed = true;
+	for (int numOfLinks = 2; numOfLinks <= IK_MAX_ANALYTIC_LINKS; numOfLinks++)
+	{
+		IKChain chain(numOfLinks, vec3(0), LINK_LENGTH);
+		for (int i = 0; i < NUM_OF_CHECK_TARGETS; i++)
+		{
+			chain.reset();
+			vec3 target = chain.getBasePosition() + CHECK_TARGETS[i] * chain.getMaxLength();
+			IKSolveResult result = chain.solve(target, MAX_SOLVE_ITERATIONS, SOLVE_TOLERANCE);
+			isPassed = checkConverged("analytic", chain, target, result) && isPassed;
+			if ((result.iterations != 1) || (result.residual > CHECK_RESIDUAL_EPSILON))
+			{
+				std::cout << "  FAILED analytic, " << numOfLinks << " links: residual " << result.residual << " after " << result.iterations << " iterations" << std::endl;
+				isPassed = false;
+			}
+		}
+	}
+	return isPassed;
+}
+
+/*
+* checkStepPolicies
+*
+* @tbrief Solve the check targets with CCD's adaptive step policy and a stiff base, and again with a base that mustn't move.
+* @treturn true if every solve with the stiff base converged and the fixed base never moved.
+*/
+static bool checkStepPolicies()
+{
+	bool isPassed = true;
+	IKChain chain(DEFAULT_NUM_OF_LINKS, vec3(0), LINK_LENGTH);
+	chain.setAnalyticEnabled(false);
+	chain.setStepPolicy(IK_STEP_ADAPTIVE);
+	for (int i = 0; i < NUM_OF_CHECK_TARGETS; i++)
+	{
+		vec3 target = chain.getBasePosition() + CHECK_TARGETS[i] * chain.getMaxLength();
+
+		chain.setJointStiffness(IK_BASE_LINK_INDEX, 0.5f);
+		chain.reset();
+		IKSolveResult result = chain.solve(target, MAX_SOLVE_ITERATIONS, SOLVE_TOLERANCE);
+		isPassed = checkConverged("adaptive CCD, stiff base", chain, target, result) && isPassed;
+
+		chain.setJointStiffness(IK_BASE_LINK_INDEX, 1.0f);
+		chain.reset();
+		chain.solve(target, MAX_SOLVE_ITERATIONS, SOLVE_TOLERANCE);
+		if (abs(chain.getLinkRotation(IK_BASE_LINK_INDEX).w - 1.0f) > CHECK_UNIT_EPSILON)
+		{
+			std::cout << "  FAILED adaptive CCD, fixed base: the base rotated" << std::endl;
+			isPassed = false;
+		}
+	}
+	return isPassed;
+}
+
+/*
+* checkStretch
+*
+* @tbrief Stretch a chain with an end effector offset towards the check targets moved out of its reach, the chain must lie
+* straight on the line from its base to the target and report the gap that's left.
+* @treturn true if every stretch did.
+*/
+static bool checkStretch()
+{
+	bool isPassed = true;
+	IKChain chain(DEFAULT_NUM_OF_LINKS, vec3(0), LINK_LENGTH);
+	chain.setEndEffectorOffset(VIEWER_END_EFFECTOR_OFFSET);
+	chain.setStretchEnabled(true);
+	for (int i = 0; i < NUM_OF_CHECK_TARGETS; i++)
+	{
+		vec3 direction = normalize(CHECK_TARGETS[i]);
+		vec3 target = chain.getBasePosition() + direction * chain.getMaxLength() * OUT_OF_REACH_MIN_DISTANCE;
+		chain.reset();
+		IKSolveResult result = chain.solve(target, MAX_SOLVE_ITERATIONS, SOLVE_TOLERANCE);
+		vec3 stretchedPoint = chain.getBasePosition() + direction * chain.getMaxLength();
+		if (result.isReachable || (distance(chain.getEndEffectorPoint(), stretchedPoint) > CHECK_RESIDUAL_EPSILON) ||
+			(abs(result.residual - distance(target, stretchedPoint)) > CHECK_RESIDUAL_EPSILON))
+		{
+			std::cout << "  FAILED stretch: residual " << result.residual << ", end " << distance(chain.getEndEffectorPoint(), stretchedPoint)
+				<< " away from the stretched chain's end" << std::endl;
+			isPassed = false;
+		}
+	}
+	return isPassed;
+}
+
+/*
+* checkPoseCache
+*
+* @tbrief Fill a pose cache with poses of targets three cells apart, check a target next to a cached one is seeded with its pose,
+* and that the least recently used pose is the one replaced once the cache is full.
+* @treturn true if the check passed.
+*/
+static bool checkPoseCache()
+{
+	IKChain chain(DEFAULT_NUM_OF_LINKS, vec3(0), LINK_LENGTH);
+	IKPoseCache poseCache(POSE_CACHE_CAPACITY, DEFAULT_NUM_OF_LINKS, POSE_CACHE_CELL_SIZE);
+	vec3 firstTarget = chain.getBasePosition() + CHECK_TARGETS[0] * chain.getMaxLength();
+	vec3 step = vec3(3 * POSE_CACHE_CELL_SIZE, 0, 0);
+	chain.solve(firstTarget, MAX_SOLVE_ITERATIONS, SOLVE_TOLERANCE);
+	quat firstRotation = chain.getLinkRotation(DEFAULT_NUM_OF_LINKS - 1);
+	poseCache.store(chain, firstTarget);
+	chain.reset();
+	for (int i = 1; i < POSE_CACHE_CAPACITY; i++)
+	{
+		poseCache.store(chain, firstTarget + step * float(i));
+	}
+
+	// Half a cell from the first target, its pose is the only one near enough.
+	bool isPassed = poseCache.warmStart(chain, firstTarget - step / 6.0f) && (chain.getLinkRotation(DEFAULT_NUM_OF_LINKS - 1) == firstRotation);
+
+	// One more pose replaces the second target's, the first target's was just used.
+	chain.reset();
+	poseCache.store(chain, firstTarget + step * float(POSE_CACHE_CAPACITY));
+	isPassed = isPassed && !poseCache.warmStart(chain, firstTarget + step);
+	isPassed = isPassed && poseCache.warmStart(chain, firstTarget);
+	if (!isPassed)
+	{
+		std::cout << "  FAILED pose cache: hits " << poseCache.getNumOfHits() << ", misses " << poseCache.getNumOfMisses() << std::endl;
+	}
+	return isPassed;
+}
+
+/*
+* checkMultiResolution
+*
+* @tbrief Solve the check targets with a chain long enough for the multi-resolution solve, from the straight pose
+* most of them can't be reached within the iterations budget without the proxy chain.
+* @treturn true if every solve converged and left unit rotations and up to date forward kinematics.
+*/
+static bool checkMultiResolution()
+{
+	bool isPassed = true;
+	IKChain chain(IK_MULTIRES_MIN_LINKS, vec3(0), LINK_LENGTH);
+	for (int i = 0; i < NUM_OF_CHECK_TARGETS; i++)
+	{
+		chain.reset();
+		vec3 target = chain.getBasePosition() + CHECK_TARGETS[i] * chain.getMaxLength();
+		IKSolveResult result = chain.solve(target, MAX_SOLVE_ITERATIONS, SOLVE_TOLERANCE);
+		isPassed = checkConverged("multi-resolution", chain, target, result) && isPassed;
+		isPassed = checkUnitRotations("multi-resolution", chain) && isPassed;
+		isPassed = checkForwardKinematics("multi-resolution", chain) && isPassed;
+	}
+	return isPassed;
+}
+
+/*
+* checkAnytime
+*
+* @tbrief Deadline solves of the check targets with a short and a multi-resolution chain, a deadline that already passed
+* must leave the chain untouched and a generous one must converge like a solve.
+* @treturn true if every check passed.
+*/
+static bool checkAnytime()
+{
+	static const int numOfLinks[] = { DEFAULT_NUM_OF_LINKS, IK_MULTIRES_MIN_LINKS };
+
+	bool isPassed = true;
+	for (int j = 0; j < 2; j++)
+	{
+		IKChain chain(numOfLinks[j], vec3(0), LINK_LENGTH);
+		for (int i = 0; i < NUM_OF_CHECK_TARGETS; i++)
+		{
+			chain.reset();
+			vec3 target = chain.getBasePosition() + CHECK_TARGETS[i] * chain.getMaxLength();
+			vec3 endEffector = chain.getEndEffectorPoint();
+			IKSolveResult result = chain.solveUntil(target, IKClock::now(), SOLVE_TOLERANCE);
+			if ((result.iterations != 0) || (distance(endEffector, chain.getEndEffectorPoint()) > CHECK_RESIDUAL_EPSILON))
+			{
+				std::cout << "  FAILED anytime, " << numOfLinks[j] << " links: " << result.iterations << " iterations after the deadline" << std::endl;
+				isPassed = false;
+			}
+
+			result = chain.solveUntil(target, IKClock::now() + std::chrono::seconds(1), SOLVE_TOLERANCE);
+			isPassed = checkConverged("anytime", chain, target, result) && isPassed;
+			isPassed = checkUnitRotations("anytime", chain) && isPassed;
+			isPassed = checkForwardKinematics("anytime", chain) && isPassed;
+		}
+	}
+	return isPassed;
+}
+
+/*
+* runChecks
+*
+* @tbrief Check mode, solve fixed targets and check the outcomes instead of timing the solves.
+* Usage: IKBenchmark --check
+* @treturn 0 if every check passed, 1 otherwise.
+*/
+static int runChecks()
+{
+	bool isPassed = checkSolvers();
+	isPassed = checkAnalyticSolves() && isPassed;
+	isPassed = checkStepPolicies() && isPassed;
+	isPassed = checkPoseCache() && isPassed;
+	isPassed = checkStretch() && isPassed;
+	isPassed = checkMultiResolution() && isPassed;
+	isPassed = checkAnytime() && isPassed;
+	std::cout << (isPassed ? "All checks passed" : "Checks FAILED") << std::endl;
+	return isPassed ? 0 : 1;
+}
+
+/*
+* Headless IK benchmark, solves random reachable targets from the straight pose and reports the solves per second,
+* chain by chain with every IKChain solver (and again on targets near the reachable boundary), stretching towards out of reach targets,
+* the CCD step policies on standard targets, an animation loop with and without the pose cache, the closed form solve of short chains against CCD, once with the SIMD batch solver and once with the batch solver on all the cores,
+* sequential against Jacobi CCD on long chains, flat against multi-resolution solves of a long chain, and deadline solves with
+* growing time budgets, and mixed priority solve jobs on the deadline scheduler.
+* Usage: IKBenchmark [numOfSolves] [numOfLinks]
+*        IKBenchmark --build-reachability <path> [numOfLinks] [resolution] [numOfSolves]
+*        IKBenchmark --check
+*/
+int main(int argc, char** argv)
+{
+	if (argc > 1 && strcmp(argv[1], "--check") == 0)
+	{
+		return runChecks();
+	}
+	if (argc > 1 && strcmp(argv[1], "--build-reachability") == 0)
+	{
+		return buildReachabilityMap(argc, argv);
+	}
+
+	int numOfSolves = (argc > 1) ? atoi(argv[1]) : DEFAULT_NUM_OF_SOLVES;
+	int numOfLinks = (argc > 2) ? atoi(argv[2]) : DEFAULT_NUM_OF_LINKS;
+
+	std::cout << "Links: " << numOfLinks << ", solves: " << numOfSolves << ", SIMD width: " << IK_SIMD_WIDTH << std::endl;
+
+	// The same random targets for all the solvers.
+	IKChain chain(numOfLinks, vec3(0), LINK_LENGTH);
+	std::mt19937 generator(1234);
+	std::vector<vec3> targets(numOfSolves);
+	for (int i = 0; i < numOfSolves; i++)
+	{
+		targets[i] = randomReachablePoint(generator, chain.getBasePosition(), chain.getMaxLength());
+	}
+
+	// Scalar, one chain at a time, always iterating so short chains compare the iterative solvers as well.
+	std::vector<IKSolveResult> results(numOfSolves);
+	chain.setAnalyticEnabled(false);
+	for (int i = 0; i < NUM_OF_SCALAR_SOLVERS; i++)
+	{
+		double seconds = solveChainByChain(chain, SCALAR_SOLVER_TYPES[i], targets, results);
+		printResults(SCALAR_SOLVER_NAMES[i], results, seconds);
+	}
+
+	// Scalar, targets near the edge of the reachable sphere.
+	std::vector<vec3> boundaryTargets(numOfSolves);
+	for (int i = 0; i < numOfSolves; i++)
+	{
+		boundaryTargets[i] = randomBoundaryPoint(generator, chain.getBasePosition(), chain.getMaxLength());
+	}
+	for (int i = 0; i < NUM_OF_SCALAR_SOLVERS; i++)
+	{
+		double seconds = solveChainByChain(chain, SCALAR_SOLVER_TYPES[i], boundaryTargets, results);
+		std::cout << "[boundary] ";
+		printResults(SCALAR_SOLVER_NAMES[i], results, seconds);
+	}
+
+	// Scalar, out of reach targets, the chain is stretched towards them.
+	std::uniform_real_distribution<float> outOfReachDistance(OUT_OF_REACH_MIN_DISTANCE, OUT_OF_REACH_MAX_DISTANCE);
+	std::vector<vec3> outOfReachTargets(numOfSolves);
+	for (int i = 0; i < numOfSolves; i++)
+	{
+		vec3 direction = randomBoundaryPoint(generator, vec3(0), 1.0f);
+		outOfReachTargets[i] = chain.getBasePosition() + normalize(direction) * chain.getMaxLength() * outOfReachDistance(generator);
+	}
+	chain.setStretchEnabled(true);
+	printResults("[out of reach] IKChain stretch", results, solveChainByChain(chain, IK_SOLVER_CCD, outOfReachTargets, results));
+	chain.setStretchEnabled(false);
+
+	printStepPolicies(numOfLinks);
+
+	// An animation loop, the same path around the base over and over with a little jitter, solved in order.
+	std::vector<vec3> loopTargets(numOfSolves);
+	std::uniform_real_distribution<float> jitter(-ANIMATION_LOOP_JITTER, ANIMATION_LOOP_JITTER);
+	for (int i = 0; i < numOfSolves; i++)
+	{
+		float angle = 2 * 3.14159265f * (i % ANIMATION_LOOP_SAMPLES) / ANIMATION_LOOP_SAMPLES;
+		vec3 point = vec3(cos(angle), sin(angle), 0.5f * sin(3 * angle)) * ANIMATION_LOOP_RADIUS * chain.getMaxLength();
+		loopTargets[i] = chain.getBasePosition() + point + vec3(jitter(generator), jitter(generator), jitter(generator));
+	}
+	printResults("[animation loop] IKChain CCD", results, solveAnimationLoop(chain, NULL, loopTargets, results));
+
+	IKPoseCache poseCache(POSE_CACHE_CAPACITY, numOfLinks, POSE_CACHE_CELL_SIZE);
+	printResults("[animation loop] IKChain CCD + IKPoseCache", results, solveAnimationLoop(chain, &poseCache, loopTargets, results));
+	std::cout << "  Cache hits / misses: " << poseCache.getNumOfHits() << " / " << poseCache.getNumOfMisses() << std::endl;
+
+	// Short chains, the closed form solve against iterative CCD.
+	for (int numOfShortLinks = 2; numOfShortLinks <= IK_MAX_ANALYTIC_LINKS; numOfShortLinks++)
+	{
+		IKChain shortChain(numOfShortLinks, vec3(0), LINK_LENGTH);
+		std::vector<vec3> shortTargets(numOfSolves);
+		for (int i = 0; i < numOfSolves; i++)
+		{
+			shortTargets[i] = randomReachablePoint(generator, shortChain.getBasePosition(), shortChain.getMaxLength());
+		}
+
+		std::cout << "[" << numOfShortLinks << " links] ";
+		shortChain.setAnalyticEnabled(false);
+		printResults("IKChain CCD", results, solveChainByChain(shortChain, IK_SOLVER_CCD, shortTargets, results));
+
+		std::cout << "[" << numOfShortLinks << " links] ";
+		shortChain.setAnalyticEnabled(true);
+		printResults("IKChain analytic", results, solveChainByChain(shortChain, IK_SOLVER_CCD, shortTargets, results));
+	}
+
+	// Batch, all the chains at once.
+	IKBatchSolver batchSolver(numOfSolves, numOfLinks, LINK_LENGTH);
+	for (int i = 0; i < numOfSolves; i++)
+	{
+		batchSolver.setBasePosition(i, chain.getBasePosition());
+		batchSolver.setTargetPoint(i, targets[i]);
+	}
+	IKBatchSolveStats stats = batchSolver.solve(MAX_SOLVE_ITERATIONS, SOLVE_TOLERANCE);
+	for (int i = 0; i < numOfSolves; i++)
+	{
+		results[i] = batchSolver.getResult(i);
+	}
+	printResults("IKBatchSolver CCD", results, stats.seconds);
+
+	// Batch, spread across all the cores.
+	IKTaskScheduler scheduler;
+	batchSolver.reset();
+	stats = batchSolver.solve(MAX_SOLVE_ITERATIONS, SOLVE_TOLERANCE, &scheduler);
+	for (int i = 0; i < numOfSolves; i++)
+	{
+		results[i] = batchSolver.getResult(i);
+	}
+	std::cout << "Workers: " << scheduler.getNumOfWorkers() << std::endl;
+	printResults("IKBatchSolver CCD + IKTaskScheduler", results, stats.seconds);
+
+	// Long chains, where Jacobi CCD's independent joints pay off.
+	printLongChains(scheduler);
+
+	// A long chain solved flat and from a coarse proxy chain.
+	printMultiResolution();
+
+	// Deadline solves, the accuracy every time budget buys.
+	bool isPassed = printAnytimeBudgets();
+
+	// Mixed priority solve jobs, critical chains every frame and background chains that may lag.
+	isPassed = printJobScheduler() && isPassed;
+
+	return isPassed ? 0 : 1;
+}
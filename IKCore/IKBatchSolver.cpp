@@ -0,0 +1,265 @@
+#include "IKBatchSolver.h"
+#include "IKSimd.h"
+#include <chrono>
+
+// Number of floats stored in the scratch memory per link per lane, the joint's position and its parent's world rotation.
+static const int SCRATCH_FLOATS_PER_LINK = 7;
+
+// Number of lane groups a worker takes at once when the solve runs on a task scheduler.
+static const int LANE_GROUPS_PER_TASK = 8;
+
+IKBatchSolver::IKBatchSolver(int numOfChains, int numOfLinks, float linkLength)
+{
+	m_numOfChains = numOfChains;
+	m_numOfLinks = numOfLinks;
+	m_linkLength = linkLength;
+
+	// Round the number of chains up to whole SIMD lane groups, the padding chains are already solved.
+	m_numOfLanes = (numOfChains + IK_SIMD_WIDTH - 1) / IK_SIMD_WIDTH * IK_SIMD_WIDTH;
+
+	int numOfJointValues = m_numOfLanes * numOfLinks;
+	m_rotationX.resize(numOfJointValues);
+	m_rotationY.resize(numOfJointValues);
+	m_rotationZ.resize(numOfJointValues);
+	m_rotationW.resize(numOfJointValues);
+
+	m_baseX.assign(m_numOfLanes, 0.0f);
+	m_baseY.assign(m_numOfLanes, 0.0f);
+	m_baseZ.assign(m_numOfLanes, 0.0f);
+	m_targetX.assign(m_numOfLanes, 0.0f);
+	m_targetY.assign(m_numOfLanes, 0.0f);
+	m_targetZ.assign(m_numOfLanes, getMaxLength());
+	m_endEffectorX.assign(m_numOfLanes, 0.0f);
+	m_endEffectorY.assign(m_numOfLanes, 0.0f);
+	m_endEffectorZ.assign(m_numOfLanes, 0.0f);
+	m_residuals.assign(m_numOfLanes, 0.0f);
+	m_iterations.assign(m_numOfLanes, 0.0f);
+	m_isReachable.assign(m_numOfLanes, 0.0f);
+
+	reset();
+}
+
+/*
+* reset
+*
+* @tbrief Straighten all the chains along the z axis above their bases.
+*/
+void IKBatchSolver::reset()
+{
+	for (int i = 0; i < m_numOfLanes * m_numOfLinks; i++)
+	{
+		m_rotationX[i] = 0.0f;
+		m_rotationY[i] = 0.0f;
+		m_rotationZ[i] = 0.0f;
+		m_rotationW[i] = 1.0f;
+	}
+}
+
+/*
+* setBasePosition
+*
+* @tbrief Place a chain so the bottom of its base link is at the given position.
+*/
+void IKBatchSolver::setBasePosition(int chain, vec3 position)
+{
+	m_baseX[chain] = position.x;
+	m_baseY[chain] = position.y;
+	m_baseZ[chain] = position.z;
+}
+
+void IKBatchSolver::setTargetPoint(int chain, vec3 point)
+{
+	m_targetX[chain] = point.x;
+	m_targetY[chain] = point.y;
+	m_targetZ[chain] = point.z;
+}
+
+int IKBatchSolver::getNumOfChains()
+{
+	return m_numOfChains;
+}
+
+int IKBatchSolver::getNumOfLinks()
+{
+	return m_numOfLinks;
+}
+
+float IKBatchSolver::getMaxLength()
+{
+	return m_linkLength * m_numOfLinks;
+}
+
+/*
+* getScratchSize
+*
+* @tbrief The number of floats of scratch memory needed to solve a single group of IK_SIMD_WIDTH chains.
+*/
+int IKBatchSolver::getScratchSize()
+{
+	return m_numOfLinks * SCRATCH_FLOATS_PER_LINK * IK_SIMD_WIDTH;
+}
+
+/*
+* solve
+*
+* @tbrief Solve all the chains to their targets with CCD, every chain stops once it's within tolerance of its target.
+* @tparam maxIterations The maximal number of CCD sweeps to run per chain.
+* @tparam tolerance Distance from the target at which the target counts as reached.
+* @tparam scheduler Optional, spread the chains across the scheduler's workers instead of solving on the calling thread.
+* @treturn The time the solve took and the number of solves per second.
+*/
+IKBatchSolveStats IKBatchSolver::solve(int maxIterations, float tolerance, IKTaskScheduler* scheduler)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	// One scratch buffer per worker, only allocated the first time a worker needs it.
+	int numOfWorkers = scheduler ? scheduler->getNumOfWorkers() : 1;
+	if ((int)m_workerScratch.size() < numOfWorkers)
+	{
+		m_workerScratch.resize(numOfWorkers, std::vector<float>(getScratchSize()));
+	}
+
+	int numOfLaneGroups = m_numOfLanes / IK_SIMD_WIDTH;
+	if (scheduler)
+	{
+		scheduler->parallelFor(numOfLaneGroups, LANE_GROUPS_PER_TASK, [&](int begin, int end, int workerIndex)
+		{
+			for (int group = begin; group < end; group++)
+			{
+				solveLanes(group * IK_SIMD_WIDTH, maxIterations, tolerance, &m_workerScratch[workerIndex][0]);
+			}
+		});
+	}
+	else
+	{
+		for (int group = 0; group < numOfLaneGroups; group++)
+		{
+			solveLanes(group * IK_SIMD_WIDTH, maxIterations, tolerance, &m_workerScratch[0][0]);
+		}
+	}
+
+	IKBatchSolveStats stats;
+	stats.numOfChains = m_numOfChains;
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	stats.solvesPerSecond = m_numOfChains / stats.seconds;
+	return stats;
+}
+
+/*
+* solveLanes
+*
+* @tbrief Solve a group of IK_SIMD_WIDTH chains, one chain per SIMD lane.
+* Every sweep runs the forward kinematics once, the joints are then visited from the last to the base like in IKChain.
+* A joint's position and its parent's rotation don't change while the joints above it rotate, and the end of the chain
+* is rotated along with every joint, so every joint costs a constant amount of work.
+* @tparam firstChain Index of the group's first chain, a multiple of IK_SIMD_WIDTH.
+* @tparam scratch getScratchSize() floats of memory for the group's forward kinematics.
+*/
+void IKBatchSolver::solveLanes(int firstChain, int maxIterations, float tolerance, float* scratch)
+{
+	const IKSimdFloat zero(0.0f);
+	const IKSimdFloat one(1.0f);
+	const IKSimdFloat linkLength(m_linkLength);
+
+	IKSimdVec3 base(IKSimdFloat::load(&m_baseX[firstChain]), IKSimdFloat::load(&m_baseY[firstChain]), IKSimdFloat::load(&m_baseZ[firstChain]));
+	IKSimdVec3 target(IKSimdFloat::load(&m_targetX[firstChain]), IKSimdFloat::load(&m_targetY[firstChain]), IKSimdFloat::load(&m_targetZ[firstChain]));
+
+	// Target too far, don't waste sweeps on it.
+	IKSimdFloat isReachable = length(target - base) <= IKSimdFloat(getMaxLength());
+	IKSimdFloat iterations = zero;
+	IKSimdVec3 endEffector;
+	IKSimdFloat residual;
+
+	for (int iteration = 0; ; iteration++)
+	{
+		// Forward kinematics, keep every joint's position and its parent's world rotation for the sweep.
+		IKSimdQuat worldRotation(zero, zero, zero, one);
+		IKSimdVec3 joint = base;
+		for (int i = 0; i < m_numOfLinks; i++)
+		{
+			float* linkScratch = scratch + i * SCRATCH_FLOATS_PER_LINK * IK_SIMD_WIDTH;
+			joint.x.store(linkScratch);
+			joint.y.store(linkScratch + IK_SIMD_WIDTH);
+			joint.z.store(linkScratch + 2 * IK_SIMD_WIDTH);
+			worldRotation.x.store(linkScratch + 3 * IK_SIMD_WIDTH);
+			worldRotation.y.store(linkScratch + 4 * IK_SIMD_WIDTH);
+			worldRotation.z.store(linkScratch + 5 * IK_SIMD_WIDTH);
+			worldRotation.w.store(linkScratch + 6 * IK_SIMD_WIDTH);
+
+			int index = i * m_numOfLanes + firstChain;
+			IKSimdQuat rotation(IKSimdFloat::load(&m_rotationX[index]), IKSimdFloat::load(&m_rotationY[index]), IKSimdFloat::load(&m_rotationZ[index]), IKSimdFloat::load(&m_rotationW[index]));
+			worldRotation = worldRotation * rotation;
+			joint = joint + rotate(worldRotation, IKSimdVec3(zero, zero, linkLength));
+		}
+		endEffector = joint;
+		residual = length(target - endEffector);
+
+		IKSimdFloat isActive = isReachable & (residual > IKSimdFloat(tolerance));
+		if (!anyLane(isActive) || iteration == maxIterations)
+		{
+			break;
+		}
+		iterations = select(isActive, iterations + one, iterations);
+
+		// A single CCD sweep, from the last link down to the base link.
+		for (int i = m_numOfLinks - 1; i >= 0; i--)
+		{
+			const float* linkScratch = scratch + i * SCRATCH_FLOATS_PER_LINK * IK_SIMD_WIDTH;
+			IKSimdVec3 r(IKSimdFloat::load(linkScratch), IKSimdFloat::load(linkScratch + IK_SIMD_WIDTH), IKSimdFloat::load(linkScratch + 2 * IK_SIMD_WIDTH));
+			IKSimdQuat parentRotation(IKSimdFloat::load(linkScratch + 3 * IK_SIMD_WIDTH), IKSimdFloat::load(linkScratch + 4 * IK_SIMD_WIDTH),
+				IKSimdFloat::load(linkScratch + 5 * IK_SIMD_WIDTH), IKSimdFloat::load(linkScratch + 6 * IK_SIMD_WIDTH));
+
+			// r = link root, e = chain end, d = desired endpoint, rotate re onto rd in world space.
+			IKSimdVec3 re = endEffector - r;
+			IKSimdQuat worldDelta = rotationBetween(re, target - r);
+			worldDelta = select(isActive, worldDelta, IKSimdQuat(zero, zero, zero, one));
+			endEffector = r + rotate(worldDelta, re);
+
+			// The rotation is applied in the frame the link is attached to.
+			int index = i * m_numOfLanes + firstChain;
+			IKSimdQuat rotation(IKSimdFloat::load(&m_rotationX[index]), IKSimdFloat::load(&m_rotationY[index]), IKSimdFloat::load(&m_rotationZ[index]), IKSimdFloat::load(&m_rotationW[index]));
+			rotation = normalize(conjugate(parentRotation) * worldDelta * parentRotation * rotation);
+			rotation.x.store(&m_rotationX[index]);
+			rotation.y.store(&m_rotationY[index]);
+			rotation.z.store(&m_rotationZ[index]);
+			rotation.w.store(&m_rotationW[index]);
+		}
+	}
+
+	endEffector.x.store(&m_endEffectorX[firstChain]);
+	endEffector.y.store(&m_endEffectorY[firstChain]);
+	endEffector.z.store(&m_endEffectorZ[firstChain]);
+	residual.store(&m_residuals[firstChain]);
+	iterations.store(&m_iterations[firstChain]);
+	select(isReachable, one, zero).store(&m_isReachable[firstChain]);
+}
+
+IKSolveResult IKBatchSolver::getResult(int chain)
+{
+	IKSolveResult result;
+	result.iterations = (int)m_iterations[chain];
+	result.residual = m_residuals[chain];
+	result.isReachable = m_isReachable[chain] != 0.0f;
+	return result;
+}
+
+/*
+* getLinkRotation
+*
+* @tbrief A link's rotation relative to the link it's attached to (the chain's base for the base link).
+*/
+quat IKBatchSolver::getLinkRotation(int chain, int link)
+{
+	int index = link * m_numOfLanes + chain;
+	return quat(m_rotationW[index], m_rotationX[index], m_rotationY[index], m_rotationZ[index]);
+}
+
+/*
+* getEndEffectorPoint
+*
+* @tbrief The end of a chain, top of its last link, as of the last solve.
+*/
+vec3 IKBatchSolver::getEndEffectorPoint(int chain)
+{
+	return vec3(m_endEffectorX[chain], m_endEffectorY[chain], m_endEffectorZ[chain]);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "IKChain.h"
+#include "IKTaskScheduler.h"
+#include "glm/gtc/quaternion.hpp"
+#include <vector>
+
+// Timing of a batch solve.
+struct IKBatchSolveStats
+{
+	int numOfChains;
+	double seconds;
+	double solvesPerSecond;
+};
+
+/*
+* IKBatchSolver
+*
+* Solves many independent chains with CCD at once, IK_SIMD_WIDTH chains per SIMD lane group.
+* All the chains have the same number of links and link length, every link rotates around its bottom point and points along its z axis.
+* The chains are stored as a structure of arrays, for every joint index the values of all the chains are contiguous:
+* value[link * m_numOfLanes + chain].
+* Given a task scheduler, the lane groups are spread across its workers, every worker has its own scratch memory.
+*/
+class IKBatchSolver
+{
+	public:
+		IKBatchSolver(int numOfChains, int numOfLinks, float linkLength);
+
+		// Chains setup.
+		void reset();
+		void setBasePosition(int chain, vec3 position);
+		void setTargetPoint(int chain, vec3 point);
+
+		int getNumOfChains();
+		int getNumOfLinks();
+		float getMaxLength();
+
+		// Solving.
+		IKBatchSolveStats solve(int maxIterations, float tolerance, IKTaskScheduler* scheduler = NULL);
+
+		// Results.
+		IKSolveResult getResult(int chain);
+		quat getLinkRotation(int chain, int link);
+		vec3 getEndEffectorPoint(int chain);
+
+	private:
+		int getScratchSize();
+		void solveLanes(int firstChain, int maxIterations, float tolerance, float* scratch);
+
+		int m_numOfChains;
+		int m_numOfLanes;
+		int m_numOfLinks;
+		float m_linkLength;
+
+		// Local rotation of every link relative to its parent, per link per chain.
+		std::vector<float> m_rotationX, m_rotationY, m_rotationZ, m_rotationW;
+
+		// Per chain.
+		std::vector<float> m_baseX, m_baseY, m_baseZ;
+		std::vector<float> m_targetX, m_targetY, m_targetZ;
+		std::vector<float> m_endEffectorX, m_endEffectorY, m_endEffectorZ;
+		std::vector<float> m_residuals;
+		std::vector<float> m_iterations;
+		std::vector<float> m_isReachable;
+
+		// Scratch memory per worker, kept between solves.
+		std::vector<std::vector<float> > m_workerScratch;
+};
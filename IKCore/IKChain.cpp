@@ -0,0 +1,1186 @@
+#include "IKChain.h"
+#include "IKSimd.h"
+#include "IKTaskScheduler.h"
+#include <algorithm>
+#include <climits>
+
+IKChain::IKChain(int numOfLinks, vec3 basePosition, float linkLength)
+{
+	// Allocate all the links once, they're never resized.
+	m_numOfLinks = numOfLinks;
+	m_links.resize(numOfLinks);
+	m_linkTransformations.resize(numOfLinks);
+	m_firstDirtyLink = IK_BASE_LINK_INDEX;
+	m_jointPositions.resize(numOfLinks + 1);
+	m_boneLengths.resize(numOfLinks);
+	m_jointWeights.assign(numOfLinks, 1.0f);
+	m_savedRotations.resize(numOfLinks);
+	m_bestRotations.resize(numOfLinks);
+	m_jacobian.resize(IK_JOINT_AXES * numOfLinks);
+	m_jacobianAxes.resize(IK_JOINT_AXES * numOfLinks);
+	m_jointAnglesStep.resize(IK_JOINT_AXES * numOfLinks);
+	m_numOfGroups = (numOfLinks + IK_MULTIRES_LINKS_PER_GROUP - 1) / IK_MULTIRES_LINKS_PER_GROUP;
+	m_proxyPoints.resize(m_numOfGroups + 1);
+	m_groupSegments.resize(m_numOfGroups);
+	m_groupRotations.resize(m_numOfGroups);
+
+	m_linkLength = linkLength;
+	m_linkBottomPoint = translate(mat4(1.0f), vec3(0, 0, -linkLength / 2));
+	m_linkTopPoint = translate(mat4(1.0f), vec3(0, 0, linkLength / 2));
+
+	// CCD steps are sized by the adaptive policy, the fixed policy rotates a link all the way unless a factor is set.
+	m_stepPolicy = IK_STEP_ADAPTIVE;
+	m_angleSizeFactor = 1;
+	m_trustRatio = IK_TRUST_RATIO_START;
+	m_trustRadius = 0;
+	m_solverType = IK_SOLVER_CCD;
+	m_iterationsSinceNormalize = 0;
+	m_isAnalyticEnabled = true;
+	m_isStretchEnabled = false;
+	m_jacobiDamping = IK_JACOBI_DAMPING_START;
+	m_taskScheduler = NULL;
+	m_isMultiResolutionEnabled = true;
+	m_iterationTime = IKClock::duration::zero();
+	m_multiResolutionTime = IKClock::duration::zero();
+	m_poleVector = vec3(0);
+
+	setEndEffectorOffset(vec3(0));
+	setBasePosition(basePosition);
+	reset();
+}
+
+/*
+* reset
+*
+* @tbrief Straighten the chain along the z axis above its base, removing all the solver's and the user's rotations.
+*/
+void IKChain::reset()
+{
+	for (int i = 0; i < m_numOfLinks; ++i)
+	{
+		IKLink& link = m_links[i];
+		link.rotation = quat();
+		link.rotateX = mat4(1.0);
+		link.rotateZ = mat4(1.0);
+		link.rotateZ2 = mat4(1.0);
+
+		// Every link starts right above the previous one, the base link keeps its position.
+		if (i > IK_BASE_LINK_INDEX)
+		{
+			link.translation = translate(mat4(1.0f), vec3(0.0f, 0.0f, m_linkLength));
+		}
+	}
+	markDirty(IK_BASE_LINK_INDEX);
+}
+
+/*
+* setBasePosition
+*
+* @tbrief Place the chain so the bottom of its base link is at the given position.
+*/
+void IKChain::setBasePosition(vec3 position)
+{
+	m_links[IK_BASE_LINK_INDEX].translation = translate(mat4(1.0f), position + vec3(0, 0, m_linkLength / 2));
+	markDirty(IK_BASE_LINK_INDEX);
+}
+
+void IKChain::translateBase(vec3 translation)
+{
+	m_links[IK_BASE_LINK_INDEX].translation = translate(mat4(1.0f), translation) * m_links[IK_BASE_LINK_INDEX].translation;
+	markDirty(IK_BASE_LINK_INDEX);
+}
+
+/*
+* setEndEffectorOffset
+*
+* @tbrief The point on the last link that should reach the target, as an offset from the top of the last link.
+*/
+void IKChain::setEndEffectorOffset(vec3 offset)
+{
+	m_endEffectorOffset = offset;
+
+	// The length of every link's bone, from its joint to the next joint or to the end effector for the last link,
+	// the chain's reach is all of them laid out in a line.
+	m_maxLength = 0;
+	for (int i = 0; i < m_numOfLinks; i++)
+	{
+		m_boneLengths[i] = length(getLinkBone(i));
+		m_maxLength += m_boneLengths[i];
+	}
+}
+
+/*
+* getLinkBone
+*
+* @tbrief The vector from a link's joint to the next link's joint, or to the end effector for the last link, in the link's coordinates.
+*/
+vec3 IKChain::getLinkBone(int index)
+{
+	vec3 bone(0, 0, m_linkLength);
+	if (index == m_numOfLinks - 1)
+	{
+		bone += m_endEffectorOffset;
+	}
+	return bone;
+}
+
+void IKChain::setSolverType(IKSolverType solverType)
+{
+	m_solverType = solverType;
+}
+
+IKSolverType IKChain::getSolverType()
+{
+	return m_solverType;
+}
+
+/*
+* setAnalyticEnabled
+*
+* @tbrief Solve chains of up to IK_MAX_ANALYTIC_LINKS links in closed form instead of with the chain's iterative solver, enabled by default.
+*/
+void IKChain::setAnalyticEnabled(bool isEnabled)
+{
+	m_isAnalyticEnabled = isEnabled;
+}
+
+void IKChain::setStepPolicy(IKStepPolicy stepPolicy)
+{
+	m_stepPolicy = stepPolicy;
+}
+
+/*
+* setAngleSizeFactor
+*
+* @tbrief The fixed step policy's divisor, every CCD correction is divided by it (1 applies the full correction).
+*/
+void IKChain::setAngleSizeFactor(int angleSizeFactor)
+{
+	m_angleSizeFactor = angleSizeFactor;
+}
+
+/*
+* setJointStiffness
+*
+* @tbrief How much a joint resists the CCD corrections, 0 (default) takes the full step and 1 doesn't move at all.
+*/
+void IKChain::setJointStiffness(int index, float stiffness)
+{
+	m_jointWeights[index] = 1.0f - clamp(stiffness, 0.0f, 1.0f);
+}
+
+/*
+* getLinkRotation
+*
+* @tbrief The solvers' rotation of a link around its joint, the pose a solve leaves the chain in.
+*/
+quat IKChain::getLinkRotation(int index)
+{
+	return m_links[index].rotation;
+}
+
+void IKChain::setLinkRotation(int index, quat rotation)
+{
+	m_links[index].rotation = rotation;
+	markDirty(index);
+}
+
+/*
+* setStretchEnabled
+*
+* @tbrief Stretch the chain towards out of reach targets in solve(), disabled by default so the chain stays where it is.
+*/
+void IKChain::setStretchEnabled(bool isEnabled)
+{
+	m_isStretchEnabled = isEnabled;
+}
+
+/*
+* setMultiResolutionEnabled
+*
+* @tbrief Start the solves of chains of at least IK_MULTIRES_MIN_LINKS links with a coarse proxy solve, enabled by default.
+*/
+void IKChain::setMultiResolutionEnabled(bool isEnabled)
+{
+	m_isMultiResolutionEnabled = isEnabled;
+}
+
+/*
+* setTaskScheduler
+*
+* @tbrief Workers for the Jacobi CCD of chains of at least IK_JACOBI_PARALLEL_MIN_LINKS links, NULL (default) for a single thread.
+*/
+void IKChain::setTaskScheduler(IKTaskScheduler* scheduler)
+{
+	m_taskScheduler = scheduler;
+}
+
+/*
+* setPoleVector
+*
+* @tbrief The world point the analytic solve bends the chain towards, vec3(0) keeps bending the way the chain is currently bent.
+*/
+void IKChain::setPoleVector(vec3 pole)
+{
+	m_poleVector = pole;
+}
+
+/*
+* rotateLinkX
+*
+* @tbrief Rotate a link around its x axis, that rotates all the links above it as well.
+* @tparam index The link's index in the chain.
+* @tparam angle Rotation angle in degrees.
+*/
+void IKChain::rotateLinkX(int index, float angle)
+{
+	IKLink& link = m_links[index];
+	link.rotateX = m_linkBottomPoint * rotate(mat4(1.0f), angle, vec3(1, 0, 0)) * m_linkTopPoint * link.rotateX;
+	markDirty(index);
+}
+
+/*
+* rotateLinkZ
+*
+* @tbrief Rotate a link around its z axis, that rotates all the links above it as well.
+* @tparam index The link's index in the chain.
+* @tparam angle Rotation angle in degrees.
+*/
+void IKChain::rotateLinkZ(int index, float angle)
+{
+	IKLink& link = m_links[index];
+	link.rotateZ = m_linkBottomPoint * rotate(mat4(1.0f), angle, vec3(0, 0, 1)) * m_linkTopPoint * link.rotateZ;
+	link.rotateZ2 = m_linkBottomPoint * rotate(mat4(1.0f), angle, vec3(0, 0, -1)) * m_linkTopPoint * link.rotateZ2;
+	markDirty(index);
+}
+
+int IKChain::getNumOfLinks()
+{
+	return m_numOfLinks;
+}
+
+float IKChain::getLinkLength()
+{
+	return m_linkLength;
+}
+
+float IKChain::getMaxLength()
+{
+	return m_maxLength;
+}
+
+vec3 IKChain::getEndEffectorOffset()
+{
+	return m_endEffectorOffset;
+}
+
+/*
+* markDirty
+*
+* @tbrief A link's local transformation changed, its world transformation and the ones of all the links above it are stale.
+*/
+void IKChain::markDirty(int index)
+{
+	m_firstDirtyLink = min(m_firstDirtyLink, index);
+}
+
+/*
+* updateTransformations
+*
+* @tbrief Forward kinematics, bring the world transformations of all the chain links up to date.
+* Only the dirty suffix of the chain is calculated, a chain that didn't change costs nothing.
+*/
+void IKChain::updateTransformations()
+{
+	updateTransformations(m_numOfLinks - 1);
+}
+
+/*
+* updateTransformations
+*
+* @tbrief Bring the world transformations up to date up to a link, the links above it stay dirty.
+* A linear pass over the dirty links, every link's transformation is calculated according to the previous link.
+* @tparam lastIndex The last link that has to be up to date.
+*/
+void IKChain::updateTransformations(int lastIndex)
+{
+	for (; m_firstDirtyLink <= lastIndex; m_firstDirtyLink++)
+	{
+		int i = m_firstDirtyLink;
+		mat4 parentTransformation = (i == IK_BASE_LINK_INDEX) ? mat4(1.0f) : m_linkTransformations[i - 1];
+		m_linkTransformations[i] = parentTransformation * getLinkLocalTransformation(m_links[i]);
+	}
+}
+
+const mat4* IKChain::getLinkTransformations()
+{
+	updateTransformations();
+	return &m_linkTransformations[0];
+}
+
+mat4 IKChain::getLinkTransformation(int index)
+{
+	updateTransformations(index);
+	return m_linkTransformations[index];
+}
+
+/*
+* getLinkLocalTransformation
+*
+* @tbrief A link's transformation relative to the previous link, the solvers' rotation is applied around the link's joint.
+* Rotating around the joint twice is the same as rotating once by the product, m_linkTopPoint * m_linkBottomPoint is the identity,
+* so the solvers only accumulate the quaternion.
+*/
+mat4 IKChain::getLinkLocalTransformation(const IKLink& link)
+{
+	// m_linkBottomPoint * R * m_linkTopPoint built directly, the rotation R moved by the joint offset R * top - top.
+	mat4 jointRotation = mat4_cast(link.rotation);
+	vec3 topOffset(0, 0, m_linkLength / 2);
+	jointRotation[3] = vec4(mat3(jointRotation) * topOffset - topOffset, 1.0f);
+	return link.translation * jointRotation * link.rotateZ2 * link.rotateX * link.rotateZ;
+}
+
+/*
+* normalizeRotations
+*
+* @tbrief Pull the links' rotation quaternions back to unit length, the products of many small rotations slowly drift away from it.
+* Every link's rotation may change, so the whole chain's transformations are stale.
+*/
+void IKChain::normalizeRotations()
+{
+	for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+	{
+		m_links[i].rotation = normalize(m_links[i].rotation);
+	}
+	markDirty(IK_BASE_LINK_INDEX);
+	m_iterationsSinceNormalize = 0;
+}
+
+/*
+* getLinkBottomPoint
+*
+* @tbrief The joint of a link, the point it rotates around.
+*/
+vec3 IKChain::getLinkBottomPoint(int index)
+{
+	return vec3(getLinkTransformation(index) * m_linkBottomPoint * vec4(0, 0, 0, 1));
+}
+
+vec3 IKChain::getBasePosition()
+{
+	return getLinkBottomPoint(IK_BASE_LINK_INDEX);
+}
+
+/*
+* getEndEffectorPoint
+*
+* @tbrief The end of the chain, top of the last link moved by the end effector offset.
+*/
+vec3 IKChain::getEndEffectorPoint()
+{
+	return vec3(getLinkTransformation(m_numOfLinks - 1) * m_linkTopPoint * vec4(m_endEffectorOffset, 1));
+}
+
+/*
+* solve
+*
+* @tbrief Run iterations of the chain's solver (CCD sweeps, FABRIK or Jacobian iterations) back to back until the end of the chain
+* is within tolerance of the target or the iterations budget is exhausted.
+* @tparam targetPoint The point the end of the chain should reach.
+* @tparam maxIterations The maximal number of iterations to run.
+* @tparam tolerance Distance from the target at which the target counts as reached.
+* @treturn The number of iterations run, the remaining distance from the target and whether the target is in the chain's reach.
+*/
+IKSolveResult IKChain::solve(vec3 targetPoint, int maxIterations, float tolerance)
+{
+	return runSolve(targetPoint, maxIterations, tolerance, IKClock::time_point::max(), false);
+}
+
+/*
+* resumeSolve
+*
+* @tbrief Carry on a solve of the same target in another slice of iterations, from the pose and the adaptive step sizes
+* the previous solve or resumeSolve left. The reachability check, the closed form and multi-resolution stages aren't run again.
+* @tparam targetPoint The point the end of the chain should reach, the same as the solve's being resumed.
+* @tparam maxIterations The maximal number of iterations to run in this slice.
+* @tparam tolerance Distance from the target at which the target counts as reached.
+* @treturn The number of iterations run in this slice, the remaining distance from the target and whether the target is in the chain's reach.
+*/
+IKSolveResult IKChain::resumeSolve(vec3 targetPoint, int maxIterations, float tolerance)
+{
+	return runSolve(targetPoint, maxIterations, tolerance, IKClock::time_point::max(), true);
+}
+
+/*
+* solveUntil
+*
+* @tbrief Anytime solve, run iterations of the chain's solver until the end of the chain is within tolerance of the target
+* or the deadline. A step isn't started if the chain's previous step of its kind, in this solve or an earlier one, wouldn't fit
+* before the deadline, a passed deadline leaves the chain untouched, and the chain is left in the pose with the lowest residual
+* seen, even if a later iteration made it worse.
+* @tparam targetPoint The point the end of the chain should reach.
+* @tparam deadline The time by which the solve returns.
+* @tparam tolerance Distance from the target at which the target counts as reached.
+* @treturn The number of iterations run, the best pose's distance from the target and whether the target is in the chain's reach.
+*/
+IKSolveResult IKChain::solveUntil(vec3 targetPoint, IKClock::time_point deadline, float tolerance)
+{
+	return runSolve(targetPoint, INT_MAX, tolerance, deadline, false);
+}
+
+/*
+* runSolve
+*
+* @tbrief The solves' shared loop, bounded by the iterations budget and, unless it's IKClock::time_point::max(), the deadline.
+* A resumed solve skips the setup stages and keeps the adaptive step sizes.
+*/
+IKSolveResult IKChain::runSolve(vec3 targetPoint, int maxIterations, float tolerance, IKClock::time_point deadline, bool isResumed)
+{
+	// With a deadline, the time the chain's last step took predicts whether the next one fits, and the best pose is kept.
+	bool hasDeadline = (deadline != IKClock::time_point::max());
+	IKClock::time_point iterationStart = hasDeadline ? IKClock::now() : deadline;
+
+	IKSolveResult result;
+	result.iterations = 0;
+	result.residual = distance(targetPoint, getEndEffectorPoint());
+	result.isReachable = distance(targetPoint, getBasePosition()) <= getMaxLength();
+
+	// Nothing fits after the deadline, not even the setup, leave the chain as it is.
+	if (hasDeadline && (iterationStart >= deadline))
+	{
+		return result;
+	}
+
+	// A resumed solve carries on from the pose and the step sizes the previous one left, its setup already ran.
+	if (!isResumed)
+	{
+		// Target too far, don't waste sweeps on it, at most point the chain at it.
+		if (!result.isReachable)
+		{
+			return m_isStretchEnabled ? stretchTowards(targetPoint) : result;
+		}
+
+		// Short chains have an exact answer, no need to iterate.
+		if (m_isAnalyticEnabled && (m_numOfLinks <= IK_MAX_ANALYTIC_LINKS) && (result.residual > tolerance))
+		{
+			runAnalyticSolve(targetPoint);
+			result.iterations = 1;
+			result.residual = distance(targetPoint, getEndEffectorPoint());
+			return result;
+		}
+
+		// Long chains, get the coarse shape from a proxy chain first and leave only the detail to the chain's solver.
+		// With a deadline, only if the last proxy stage would fit, and the proxy iterations stop at the deadline.
+		if (m_isMultiResolutionEnabled && (m_numOfLinks >= IK_MULTIRES_MIN_LINKS) && (result.residual > tolerance) && (maxIterations > 0) &&
+			(!hasDeadline || (iterationStart + m_multiResolutionTime < deadline)))
+		{
+			runMultiResolutionSolve(targetPoint, tolerance, deadline);
+			result.iterations = 1;
+			result.residual = distance(targetPoint, getEndEffectorPoint());
+			if (hasDeadline)
+			{
+				IKClock::time_point now = IKClock::now();
+				m_multiResolutionTime = std::max(now - iterationStart, m_multiResolutionTime - m_multiResolutionTime / IK_STEP_TIME_DECAY);
+				iterationStart = now;
+			}
+		}
+
+		m_trustRatio = IK_TRUST_RATIO_START;
+		m_jacobiDamping = IK_JACOBI_DAMPING_START;
+	}
+
+	float bestResidual = result.residual;
+	if (hasDeadline)
+	{
+		for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+		{
+			m_bestRotations[i] = m_links[i].rotation;
+		}
+	}
+
+	while (result.residual > tolerance && result.iterations < maxIterations)
+	{
+		if (hasDeadline && (iterationStart + m_iterationTime >= deadline))
+		{
+			break;
+		}
+
+		runIteration(targetPoint);
+		result.iterations++;
+
+		// Counted across solves, so many short solves renormalize as well.
+		if (++m_iterationsSinceNormalize == IK_RENORMALIZE_INTERVAL)
+		{
+			normalizeRotations();
+		}
+		result.residual = distance(targetPoint, getEndEffectorPoint());
+
+		if (hasDeadline)
+		{
+			IKClock::time_point now = IKClock::now();
+			m_iterationTime = std::max(now - iterationStart, m_iterationTime - m_iterationTime / IK_STEP_TIME_DECAY);
+			iterationStart = now;
+			if (result.residual < bestResidual)
+			{
+				bestResidual = result.residual;
+				for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+				{
+					m_bestRotations[i] = m_links[i].rotation;
+				}
+			}
+		}
+	}
+
+	// The last iterations made things worse, go back to the best pose.
+	if (hasDeadline && (bestResidual < result.residual))
+	{
+		for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+		{
+			m_links[i].rotation = m_bestRotations[i];
+		}
+		markDirty(IK_BASE_LINK_INDEX);
+		result.residual = bestResidual;
+	}
+	return result;
+}
+
+/*
+* runIteration
+*
+* @tbrief A single iteration of the chain's solver.
+* @tparam targetPoint The point the end of the chain should reach.
+*/
+void IKChain::runIteration(vec3 targetPoint)
+{
+	switch (m_solverType)
+	{
+	case IK_SOLVER_FABRIK:
+		runFABRIKIteration(targetPoint);
+		break;
+	case IK_SOLVER_JACOBIAN_TRANSPOSE:
+	case IK_SOLVER_JACOBIAN_DLS:
+		runJacobianIteration(targetPoint);
+		break;
+	case IK_SOLVER_JACOBI_CCD:
+		runJacobiCCDSweep(targetPoint);
+		break;
+	default:
+		if (m_stepPolicy == IK_STEP_ADAPTIVE)
+		{
+			runAdaptiveCCDSweep(targetPoint);
+		}
+		else
+		{
+			runCCDSweep(targetPoint);
+		}
+		break;
+	}
+}
+
+/*
+* runJacobiCCDSweep
+*
+* @tbrief A Jacobi style CCD sweep, every joint's correction is calculated from the same snapshot of the chain,
+* so the joints are independent of each other and are calculated IK_SIMD_WIDTH joints at a time, and spread
+* over the task scheduler's workers for very long chains. All the corrections are applied at once, damped,
+* the damping grows after good sweeps, and a sweep that didn't reduce the residual is undone.
+* @tparam targetPoint The point the end of the chain should reach.
+*/
+void IKChain::runJacobiCCDSweep(vec3 targetPoint)
+{
+	// The snapshot, all the joints and parent frames up to date.
+	vec3 endEffector = getEndEffectorPoint();
+	float residual = distance(targetPoint, endEffector);
+	for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+	{
+		m_savedRotations[i] = m_links[i].rotation;
+	}
+
+	float damping = m_jacobiDamping;
+	if (m_taskScheduler && m_numOfLinks >= IK_JACOBI_PARALLEL_MIN_LINKS)
+	{
+		m_taskScheduler->parallelFor(m_numOfLinks, IK_JACOBI_JOINTS_PER_TASK, [&](int begin, int end, int /*workerIndex*/)
+		{
+			runJacobiCCDJoints(begin, end, endEffector, targetPoint, damping);
+		});
+	}
+	else
+	{
+		runJacobiCCDJoints(IK_BASE_LINK_INDEX, m_numOfLinks, endEffector, targetPoint, damping);
+	}
+	markDirty(IK_BASE_LINK_INDEX);
+
+	if (distance(targetPoint, getEndEffectorPoint()) < residual)
+	{
+		m_jacobiDamping = min(m_jacobiDamping * IK_JACOBI_DAMPING_GROW, IK_JACOBI_DAMPING_MAX);
+	}
+	else
+	{
+		for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+		{
+			m_links[i].rotation = m_savedRotations[i];
+		}
+		markDirty(IK_BASE_LINK_INDEX);
+		m_jacobiDamping = max(m_jacobiDamping * IK_JACOBI_DAMPING_SHRINK, IK_JACOBI_DAMPING_MIN);
+	}
+}
+
+/*
+* runJacobiCCDJoints
+*
+* @tbrief Calculate and apply the Jacobi CCD corrections of a range of joints, IK_SIMD_WIDTH joints at a time.
+* Only reads the snapshot's transformations and only writes the range's rotations, so ranges can run in parallel.
+* @tparam begin The first joint.
+* @tparam end One past the last joint.
+* @tparam endEffector The snapshot's end of the chain.
+* @tparam targetPoint The point the end of the chain should reach.
+* @tparam damping The part of every joint's correction to apply.
+*/
+void IKChain::runJacobiCCDJoints(int begin, int end, vec3 endEffector, vec3 targetPoint, float damping)
+{
+	// Every joint's pivot, parent frame columns and rotation, gathered into lanes. Lanes past the last joint get
+	// their pivot on the end of the chain, where the correction is the identity.
+	float lanes[16][IK_SIMD_WIDTH];
+	const IKSimdFloat one(1.0f);
+	const IKSimdFloat weight(damping);
+
+	for (int first = begin; first < end; first += IK_SIMD_WIDTH)
+	{
+		for (int lane = 0; lane < IK_SIMD_WIDTH; lane++)
+		{
+			int i = first + lane;
+			vec3 pivot = endEffector;
+			mat3 parentFrame(1.0f);
+			quat rotation;
+			if (i < end)
+			{
+				const IKLink& link = m_links[i];
+				pivot = vec3(m_linkTransformations[i] * m_linkBottomPoint * vec4(0, 0, 0, 1));
+				parentFrame = mat3((i == IK_BASE_LINK_INDEX) ? link.translation : m_linkTransformations[i - 1] * link.translation);
+				rotation = link.rotation;
+			}
+			for (int j = 0; j < 3; j++)
+			{
+				lanes[j][lane] = pivot[j];
+				lanes[3 + j][lane] = parentFrame[0][j];
+				lanes[6 + j][lane] = parentFrame[1][j];
+				lanes[9 + j][lane] = parentFrame[2][j];
+			}
+			lanes[12][lane] = rotation.x;
+			lanes[13][lane] = rotation.y;
+			lanes[14][lane] = rotation.z;
+			lanes[15][lane] = rotation.w;
+		}
+
+		IKSimdVec3 r(IKSimdFloat::load(lanes[0]), IKSimdFloat::load(lanes[1]), IKSimdFloat::load(lanes[2]));
+		IKSimdVec3 frameX(IKSimdFloat::load(lanes[3]), IKSimdFloat::load(lanes[4]), IKSimdFloat::load(lanes[5]));
+		IKSimdVec3 frameY(IKSimdFloat::load(lanes[6]), IKSimdFloat::load(lanes[7]), IKSimdFloat::load(lanes[8]));
+		IKSimdVec3 frameZ(IKSimdFloat::load(lanes[9]), IKSimdFloat::load(lanes[10]), IKSimdFloat::load(lanes[11]));
+		IKSimdQuat rotation(IKSimdFloat::load(lanes[12]), IKSimdFloat::load(lanes[13]), IKSimdFloat::load(lanes[14]), IKSimdFloat::load(lanes[15]));
+
+		// re and rd in the frame the link's rotation is applied in, and the damped rotation between them.
+		IKSimdVec3 re = IKSimdVec3(endEffector.x, endEffector.y, endEffector.z) - r;
+		IKSimdVec3 rd = IKSimdVec3(targetPoint.x, targetPoint.y, targetPoint.z) - r;
+		IKSimdVec3 localRe(dot(frameX, re), dot(frameY, re), dot(frameZ, re));
+		IKSimdVec3 localRd(dot(frameX, rd), dot(frameY, rd), dot(frameZ, rd));
+		IKSimdQuat delta = rotationBetween(localRe, localRd);
+		delta = normalize(IKSimdQuat(delta.x * weight, delta.y * weight, delta.z * weight, one - weight + delta.w * weight));
+		rotation = normalize(delta * rotation);
+
+		rotation.x.store(lanes[12]);
+		rotation.y.store(lanes[13]);
+		rotation.z.store(lanes[14]);
+		rotation.w.store(lanes[15]);
+		for (int lane = 0; lane < IK_SIMD_WIDTH && first + lane < end; lane++)
+		{
+			m_links[first + lane].rotation = quat(lanes[15][lane], lanes[12][lane], lanes[13][lane], lanes[14][lane]);
+		}
+	}
+}
+
+/*
+* rotationBetween
+*
+* @tbrief The rotation from one unit vector to the other, straight from the vectors without any trigonometry,
+* (1 + cos, sin * axis) normalized is (cos / 2, sin / 2 * axis).
+* @tparam fraction The part of the rotation's angle to apply, other than 1 it's a normalized linear interpolation from the identity.
+*/
+static quat rotationBetween(vec3 from, vec3 to, float fraction)
+{
+	vec3 axis = cross(from, to);
+	quat rotation = normalize(quat(1.0f + dot(from, to), axis.x, axis.y, axis.z));
+	if (fraction != 1.0f)
+	{
+		rotation = normalize(quat(1.0f - fraction + fraction * rotation.w, fraction * rotation.x, fraction * rotation.y, fraction * rotation.z));
+	}
+	return rotation;
+}
+
+/*
+* stretchTowards
+*
+* @tbrief Straighten the chain along the line from its base to the target in a single O(n) pass, the closest it gets
+* to a target that is out of reach.
+* @treturn A single iteration, the remaining gap between the chain's end and the target, and isReachable false.
+*/
+IKSolveResult IKChain::stretchTowards(vec3 targetPoint)
+{
+	// Lay the joints one bone length apart on the base -> target line.
+	vec3* joints = &m_jointPositions[0];
+	joints[IK_BASE_LINK_INDEX] = getBasePosition();
+	vec3 toTarget = targetPoint - joints[IK_BASE_LINK_INDEX];
+	vec3 direction = (length(toTarget) > 0.0f) ? normalize(toTarget) : vec3(0, 0, 1);
+	for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+	{
+		joints[i + 1] = joints[i] + direction * m_boneLengths[i];
+	}
+	applyJointPositions(joints);
+
+	IKSolveResult result;
+	result.iterations = 1;
+	result.residual = distance(targetPoint, getEndEffectorPoint());
+	result.isReachable = false;
+	return result;
+}
+
+/*
+* runCCDSweep
+*
+* @tbrief A single sweep of the CCD algorithm, from the last link down to the base link.
+* @tparam targetPoint The point the end of the chain should reach.
+*/
+void IKChain::runCCDSweep(vec3 targetPoint)
+{
+	// The end of the chain is tracked through the sweep, the links above the current link are left dirty and
+	// the joints below it are still up to date, so every joint costs O(1) instead of a forward kinematics pass.
+	vec3 e = getEndEffectorPoint();
+
+	// For every part in the chain rotate it according to the algorithm.
+	for (int i = (m_numOfLinks - 1); i >= IK_BASE_LINK_INDEX; i--)
+	{
+		// r = link root, e = chain end, d = desired endpoint, re = vector from r to e, rd = vector from r to d.
+		vec3 r = getLinkBottomPoint(i);
+		vec3 re = normalize(e - r);
+		vec3 rd = normalize(targetPoint - r);
+
+		// The part of the correction to apply, the joint's weight times the policy's step. The adaptive step keeps the
+		// chord the end of the chain would travel, |e - r| * |rd - re|, inside the trust region.
+		float fraction = m_jointWeights[i];
+		if (m_stepPolicy == IK_STEP_ADAPTIVE)
+		{
+			float chord = length(e - r) * length(rd - re);
+			fraction *= (chord > m_trustRadius) ? m_trustRadius / chord : 1.0f;
+		}
+		else
+		{
+			fraction /= m_angleSizeFactor;
+		}
+		if (fraction <= 0.0f)
+		{
+			continue;
+		}
+
+		// Rotate the current link by the rotation from re to rd, unless it's already pointing at the target.
+		if (!rotateLinkInWorld(i, re, rd, fraction))
+		{
+			continue;
+		}
+
+		// The end of the chain rotates rigidly with the link around its joint.
+		e = r + rotationBetween(re, rd, fraction) * (e - r);
+	}
+}
+
+/*
+* runAdaptiveCCDSweep
+*
+* @tbrief A CCD sweep inside the trust region, a radius relative to the residual so the corrections shrink as the
+* chain gets closer. The ratio grows after good progress, and a sweep that didn't reduce the residual is undone
+* and retried next iteration with a smaller ratio.
+* @tparam targetPoint The point the end of the chain should reach.
+*/
+void IKChain::runAdaptiveCCDSweep(vec3 targetPoint)
+{
+	float residual = distance(targetPoint, getEndEffectorPoint());
+	m_trustRadius = m_trustRatio * residual;
+	for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+	{
+		m_savedRotations[i] = m_links[i].rotation;
+	}
+
+	runCCDSweep(targetPoint);
+
+	float newResidual = distance(targetPoint, getEndEffectorPoint());
+	if (newResidual < residual)
+	{
+		if (newResidual < residual * IK_TRUST_GOOD_PROGRESS)
+		{
+			m_trustRatio = min(m_trustRatio * IK_TRUST_GROW, IK_TRUST_RATIO_MAX);
+		}
+	}
+	else
+	{
+		for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+		{
+			m_links[i].rotation = m_savedRotations[i];
+		}
+		markDirty(IK_BASE_LINK_INDEX);
+		m_trustRatio = max(m_trustRatio * IK_TRUST_SHRINK, IK_TRUST_RATIO_MIN);
+	}
+}
+
+/*
+* rotateLinkInWorld
+*
+* @tbrief Rotate a link around its joint by the rotation that takes one world direction to another, that rotates all the links above it as well.
+* The link and the links above it are marked dirty.
+* @tparam index The link's index in the chain.
+* @tparam from Normalized world direction.
+* @tparam to Normalized world direction.
+* @tparam fraction The part of the rotation's angle to apply.
+* @treturn false if the directions are parallel and there is nothing to rotate.
+*/
+bool IKChain::rotateLinkInWorld(int index, vec3 from, vec3 to, float fraction)
+{
+	// Already pointing at the direction, the rotation axis is undefined.
+	vec3 axis = cross(from, to);
+	if (length(axis) < 1e-6f)
+	{
+		return false;
+	}
+
+	// The rotation is applied in the frame the link is attached to, so bring the world directions into that frame.
+	IKLink& link = m_links[index];
+	mat3 parentFrame = mat3((index == IK_BASE_LINK_INDEX) ? link.translation : getLinkTransformation(index - 1) * link.translation);
+	link.rotation = rotationBetween(from * parentFrame, to * parentFrame, fraction) * link.rotation;
+	markDirty(index);
+	return true;
+}
+
+/*
+* runFABRIKIteration
+*
+* @tbrief A single iteration of the FABRIK (Forward And Backward Reaching IK) algorithm.
+* The joint positions are moved with vector operations only, then the links are rotated to match them.
+* @tparam targetPoint The point the end of the chain should reach.
+*/
+void IKChain::runFABRIKIteration(vec3 targetPoint)
+{
+	vec3* joints = &m_jointPositions[0];
+	for (int i = 0; i < m_numOfLinks; i++)
+	{
+		joints[i] = getLinkBottomPoint(i);
+	}
+	joints[m_numOfLinks] = getEndEffectorPoint();
+	vec3 basePosition = joints[IK_BASE_LINK_INDEX];
+
+	// Backward reaching, put the end effector on the target and pull every joint after the joint above it.
+	joints[m_numOfLinks] = targetPoint;
+	for (int i = m_numOfLinks - 1; i >= IK_BASE_LINK_INDEX; i--)
+	{
+		joints[i] = joints[i + 1] + normalize(joints[i] - joints[i + 1]) * m_boneLengths[i];
+	}
+
+	// Forward reaching, put the base back and pull every joint after the joint below it.
+	joints[IK_BASE_LINK_INDEX] = basePosition;
+	for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+	{
+		joints[i + 1] = joints[i] + normalize(joints[i + 1] - joints[i]) * m_boneLengths[i];
+	}
+
+	applyJointPositions(joints);
+}
+
+/*
+* applyJointPositions
+*
+* @tbrief Rotate the links, from the base up, so every link's bone points from its joint to the next joint position.
+* @tparam jointPositions The bottom of every link followed by the end effector, m_numOfLinks + 1 positions.
+*/
+void IKChain::applyJointPositions(const vec3* jointPositions)
+{
+	for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+	{
+		// Only the link's own transformation is calculated, the links below it are already in place.
+		vec3 bone = normalize(mat3(getLinkTransformation(i)) * getLinkBone(i));
+		vec3 desiredBone = jointPositions[i + 1] - getLinkBottomPoint(i);
+		if (length(desiredBone) > 0.0f)
+		{
+			rotateLinkInWorld(i, bone, normalize(desiredBone), 1.0f);
+		}
+	}
+}
+
+/*
+* buildJacobian
+*
+* @tbrief Build the 3 x (IK_JOINT_AXES * m_numOfLinks) positional Jacobian of the end effector.
+* Every joint's degrees of freedom are its ZXZ Euler axes (rotateZ2, rotateX, rotateZ) at the current pose,
+* a column is the end effector's velocity for a unit angular velocity around one of them.
+*/
+void IKChain::buildJacobian()
+{
+	vec3 endEffector = getEndEffectorPoint();
+	for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+	{
+		const IKLink& link = m_links[i];
+		mat3 parentFrame = mat3((i == IK_BASE_LINK_INDEX) ? link.translation : getLinkTransformation(i - 1) * link.translation);
+		mat3 linkRotation = mat3_cast(link.rotation);
+		vec3 pivotToEnd = endEffector - getLinkBottomPoint(i);
+
+		// The Z, X and Z axes of the ZXZ Euler angles, in the frame link.rotation is applied in.
+		vec3* axes = &m_jacobianAxes[IK_JOINT_AXES * i];
+		axes[0] = linkRotation * vec3(0, 0, 1);
+		axes[1] = linkRotation * mat3(link.rotateZ2) * vec3(1, 0, 0);
+		axes[2] = linkRotation * mat3(link.rotateZ2) * mat3(link.rotateX) * vec3(0, 0, 1);
+
+		for (int j = 0; j < IK_JOINT_AXES; j++)
+		{
+			m_jacobian[IK_JOINT_AXES * i + j] = cross(parentFrame * axes[j], pivotToEnd);
+		}
+	}
+}
+
+/*
+* solveSymmetric3x3
+*
+* @tbrief Solve A * x = b for a 3 x 3 matrix with Cramer's rule, A is positive definite so the determinant isn't zero.
+*/
+static vec3 solveSymmetric3x3(const mat3& a, vec3 b)
+{
+	vec3 c1xc2 = cross(a[1], a[2]);
+	float determinant = dot(a[0], c1xc2);
+	return vec3(dot(b, c1xc2), dot(a[0], cross(b, a[2])), dot(a[0], cross(a[1], b))) / determinant;
+}
+
+/*
+* runJacobianIteration
+*
+* @tbrief A single Jacobian iteration, solved with the Jacobian transpose or with damped least squares.
+* J * J^T is only 3 x 3, so damped least squares is a fixed size inverse instead of a pseudo inverse of the full Jacobian.
+* @tparam targetPoint The point the end of the chain should reach.
+*/
+void IKChain::runJacobianIteration(vec3 targetPoint)
+{
+	buildJacobian();
+	int numOfColumns = IK_JOINT_AXES * m_numOfLinks;
+
+	// Clamp the error so far targets don't overshoot the linearization.
+	vec3 error = targetPoint - getEndEffectorPoint();
+	float maxStep = IK_JACOBIAN_MAX_STEP * m_linkLength;
+	if (length(error) > maxStep)
+	{
+		error = normalize(error) * maxStep;
+	}
+
+	mat3 jacobianJacobianT(0.0f);
+	for (int k = 0; k < numOfColumns; k++)
+	{
+		const vec3& column = m_jacobian[k];
+		jacobianJacobianT += mat3(column * column.x, column * column.y, column * column.z);
+	}
+
+	// Transpose: dTheta = alpha * J^T * e, alpha minimizes the error along J * J^T * e.
+	// Damped least squares: dTheta = J^T * (J * J^T + lambda^2 * I)^-1 * e.
+	vec3 y;
+	if (m_solverType == IK_SOLVER_JACOBIAN_TRANSPOSE)
+	{
+		vec3 jjte = jacobianJacobianT * error;
+		float denominator = dot(jjte, jjte);
+		y = (denominator > 0.0f) ? error * (dot(error, jjte) / denominator) : vec3(0);
+	}
+	else
+	{
+		float damping = IK_DLS_DAMPING * m_linkLength;
+		y = solveSymmetric3x3(jacobianJacobianT + mat3(damping * damping), error);
+	}
+
+	for (int k = 0; k < numOfColumns; k++)
+	{
+		m_jointAnglesStep[k] = dot(m_jacobian[k], y);
+	}
+
+	// Apply all the joints' steps at once, every joint's ZXZ steps combined into a single rotation around its pivot.
+	for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+	{
+		vec3 angularStep(0);
+		for (int j = 0; j < IK_JOINT_AXES; j++)
+		{
+			angularStep += m_jacobianAxes[IK_JOINT_AXES * i + j] * m_jointAnglesStep[IK_JOINT_AXES * i + j];
+		}
+
+		float angle = length(angularStep);
+		if (angle > 1e-6f)
+		{
+			vec3 axis = angularStep / angle;
+			IKLink& link = m_links[i];
+			link.rotation = quat(cos(angle / 2), axis * sin(angle / 2)) * link.rotation;
+		}
+	}
+	markDirty(IK_BASE_LINK_INDEX);
+}
+
+/*
+* solveTwoBones
+*
+* @tbrief Place the middle joint of two bones so their end reaches the target, with the law of cosines.
+* The bones bend in the plane of the root, the target and the pole. A target out of reach straightens the bones towards it.
+* @tparam root The joint of the first bone.
+* @tparam target The point the end of the second bone should reach.
+* @tparam firstLength The first bone's length.
+* @tparam secondLength The second bone's length.
+* @tparam pole The point the middle joint bends towards.
+* @treturn The middle joint's position.
+*/
+static vec3 solveTwoBones(vec3 root, vec3 target, float firstLength, float secondLength, vec3 pole)
+{
+	vec3 toTarget = target - root;
+	float targetDistance = length(toTarget);
+	vec3 direction = (targetDistance > 1e-6f) ? toTarget / targetDistance : vec3(0, 0, 1);
+
+	// The bend direction, the pole's direction perpendicular to the root -> target line.
+	vec3 bendDirection = (pole - root) - direction * dot(pole - root, direction);
+	if (length(bendDirection) < 1e-6f)
+	{
+		// The pole is on the line, any perpendicular will do.
+		bendDirection = cross(direction, (abs(direction.x) < 0.9f) ? vec3(1, 0, 0) : vec3(0, 1, 0));
+	}
+	bendDirection = normalize(bendDirection);
+
+	// The angle at the root, between the root -> target line and the first bone.
+	float clampedDistance = clamp(targetDistance, abs(firstLength - secondLength), firstLength + secondLength);
+	float cosAngle = 1.0f;
+	if (clampedDistance > 1e-6f)
+	{
+		cosAngle = clamp((firstLength * firstLength + clampedDistance * clampedDistance - secondLength * secondLength) / (2 * firstLength * clampedDistance), -1.0f, 1.0f);
+	}
+	float sinAngle = sqrt(1.0f - cosAngle * cosAngle);
+
+	return root + (direction * cosAngle + bendDirection * sinAngle) * firstLength;
+}
+
+/*
+* runMultiResolutionSolve
+*
+* @tbrief Solve a proxy chain where every IK_MULTIRES_LINKS_PER_GROUP consecutive links act as a single rigid segment,
+* with FABRIK iterations on the proxy's joints that cost O(groups) vector work instead of O(n) matrix work, then distribute every group's rotation across its
+* links and pose the chain in a single O(n) pass. Every bone is rotated by the group rotations interpolated between
+* the middles of the groups, so the bend is spread along the chain instead of kinked at the group boundaries.
+* @tparam targetPoint The point the end of the chain should reach.
+* @tparam tolerance Distance from the target at which the proxy solve stops.
+* @tparam deadline The time after which no proxy iteration is started, IKClock::time_point::max() for none.
+*/
+void IKChain::runMultiResolutionSolve(vec3 targetPoint, float tolerance, IKClock::time_point deadline)
+{
+	bool hasDeadline = (deadline != IKClock::time_point::max());
+	vec3* joints = &m_jointPositions[0];
+	for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+	{
+		joints[i] = getLinkBottomPoint(i);
+	}
+	joints[m_numOfLinks] = getEndEffectorPoint();
+
+	// The proxy chain's joints, the bottom of every group's first link and the end effector, and its segments.
+	vec3* proxy = &m_proxyPoints[0];
+	for (int k = 0; k < m_numOfGroups; k++)
+	{
+		proxy[k] = joints[k * IK_MULTIRES_LINKS_PER_GROUP];
+	}
+	proxy[m_numOfGroups] = joints[m_numOfLinks];
+	for (int k = 0; k < m_numOfGroups; k++)
+	{
+		m_groupSegments[k] = proxy[k + 1] - proxy[k];
+	}
+
+	// FABRIK on the proxy chain, every segment keeps its length.
+	vec3 basePosition = proxy[0];
+	for (int iteration = 0; (iteration < IK_MULTIRES_PROXY_ITERATIONS) && (distance(targetPoint, proxy[m_numOfGroups]) > tolerance); iteration++)
+	{
+		if (hasDeadline && (IKClock::now() >= deadline))
+		{
+			break;
+		}
+		proxy[m_numOfGroups] = targetPoint;
+		for (int k = m_numOfGroups - 1; k >= 0; k--)
+		{
+			proxy[k] = proxy[k + 1] + normalize(proxy[k] - proxy[k + 1]) * length(m_groupSegments[k]);
+		}
+		proxy[0] = basePosition;
+		for (int k = 0; k < m_numOfGroups; k++)
+		{
+			proxy[k + 1] = proxy[k] + normalize(proxy[k + 1] - proxy[k]) * length(m_groupSegments[k]);
+		}
+	}
+
+	// Every group's world rotation, the rotation from its segment before the proxy solve to its segment after it.
+	for (int k = 0; k < m_numOfGroups; k++)
+	{
+		vec3 segment = normalize(m_groupSegments[k]);
+		vec3 proxySegment = normalize(proxy[k + 1] - proxy[k]);
+		m_groupRotations[k] = (length(cross(segment, proxySegment)) < 1e-6f) ? quat() : rotationBetween(segment, proxySegment, 1.0f);
+	}
+
+	// Rebuild the joints from the base up, every bone rotated by its place between the middles of the groups.
+	vec3 oldJoint = joints[IK_BASE_LINK_INDEX];
+	for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+	{
+		float position = (i + 0.5f) / IK_MULTIRES_LINKS_PER_GROUP - 0.5f;
+		int group = clamp(int(floor(position)), 0, m_numOfGroups - 1);
+		int nextGroup = min(group + 1, m_numOfGroups - 1);
+		quat rotation = slerp(m_groupRotations[group], m_groupRotations[nextGroup], clamp(position - group, 0.0f, 1.0f));
+
+		vec3 bone = joints[i + 1] - oldJoint;
+		oldJoint = joints[i + 1];
+		joints[i + 1] = joints[i] + rotation * bone;
+	}
+	applyJointPositions(joints);
+}
+
+/*
+* runAnalyticSolve
+*
+* @tbrief Closed form solve for chains of up to IK_MAX_ANALYTIC_LINKS links, constant time and exact whenever the target is reachable.
+* Two links are a two-bone problem. For three links the last two bones are first replaced by a single virtual bone, its length
+* keeping the bones' share of the distance to the target, which places the first joint, then the last two bones are a two-bone problem.
+* @tparam targetPoint The point the end of the chain should reach.
+*/
+void IKChain::runAnalyticSolve(vec3 targetPoint)
+{
+	vec3* joints = &m_jointPositions[0];
+	for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+	{
+		joints[i] = getLinkBottomPoint(i);
+	}
+	joints[m_numOfLinks] = getEndEffectorPoint();
+
+	// Bend towards the pole, or keep the current bend with the middle joint as the pole.
+	vec3 pole = (m_poleVector != vec3(0)) ? m_poleVector : joints[IK_BASE_LINK_INDEX + 1];
+	vec3 root = joints[IK_BASE_LINK_INDEX];
+
+	if (m_numOfLinks == 1)
+	{
+		joints[1] = targetPoint;
+	}
+	else if (m_numOfLinks == 2)
+	{
+		joints[1] = solveTwoBones(root, targetPoint, m_boneLengths[0], m_boneLengths[1], pole);
+		joints[2] = targetPoint;
+	}
+	else
+	{
+		float first = m_boneLengths[0], second = m_boneLengths[1], third = m_boneLengths[2];
+		float targetDistance = distance(root, targetPoint);
+
+		// The virtual bone from the first joint to the target, it has to be a length the last two bones can span
+		// and that closes the triangle with the first bone.
+		float minLength = max(abs(second - third), abs(targetDistance - first));
+		float maxLength = min(second + third, targetDistance + first);
+		float virtualLength = clamp(targetDistance * (second + third) / (first + second + third), minLength, max(minLength, maxLength));
+
+		joints[1] = solveTwoBones(root, targetPoint, first, virtualLength, pole);
+		joints[2] = solveTwoBones(joints[1], targetPoint, second, third, pole);
+		joints[3] = targetPoint;
+	}
+
+	applyJointPositions(joints);
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include <vector>
+#include <chrono>
+
+using namespace glm;
+
+// The clock solve deadlines are measured with.
+typedef std::chrono::steady_clock IKClock;
+
+class IKTaskScheduler;
+
+// Chain parameters, the chain starts from the base link at index 0.
+static const int IK_BASE_LINK_INDEX = 0;
+
+// Jacobian solvers, every joint has the three ZXZ axes as its degrees of freedom.
+static const int IK_JOINT_AXES = 3;
+// Damped least squares damping factor (lambda), relative to the link's length.
+static const float IK_DLS_DAMPING = 0.2f;
+// The largest step a Jacobian iteration takes towards the target, relative to the link's length.
+static const float IK_JACOBIAN_MAX_STEP = 1.0f;
+// Chains up to this many links are solved in closed form (two bones with the law of cosines, three bones as two two-bone problems).
+static const int IK_MAX_ANALYTIC_LINKS = 3;
+// Adaptive CCD trust region, the largest distance a single joint's correction may move the end of the chain,
+// as a ratio of the residual. The ratio grows after a sweep that reduced the residual to under IK_TRUST_GOOD_PROGRESS
+// of what it was, and shrinks after a sweep that didn't reduce it (that sweep is undone), never below the minimum
+// so a run of rejected sweeps can't leave the rest of the solve making no corrections at all.
+static const float IK_TRUST_RATIO_START = 0.25f;
+static const float IK_TRUST_RATIO_MIN = 1e-3f;
+static const float IK_TRUST_RATIO_MAX = 1.0f;
+static const float IK_TRUST_GOOD_PROGRESS = 0.5f;
+static const float IK_TRUST_GROW = 2.0f;
+static const float IK_TRUST_SHRINK = 0.25f;
+// Jacobi CCD, the part of every joint's correction applied at the start of a solve and its bounds, the part grows
+// after a sweep that reduced the residual and shrinks after a sweep that didn't (that sweep is undone).
+static const float IK_JACOBI_DAMPING_START = 0.05f;
+static const float IK_JACOBI_DAMPING_MIN = 1e-3f;
+static const float IK_JACOBI_DAMPING_MAX = 1.0f;
+static const float IK_JACOBI_DAMPING_GROW = 1.1f;
+static const float IK_JACOBI_DAMPING_SHRINK = 0.5f;
+// Chains from this many links spread the Jacobi CCD joints over the task scheduler's workers, in chunks of joints.
+static const int IK_JACOBI_PARALLEL_MIN_LINKS = 1024;
+static const int IK_JACOBI_JOINTS_PER_TASK = 256;
+// Multi-resolution solve, chains from this many links are first solved as a proxy chain with a segment for every
+// group of consecutive links, in at most the given number of proxy FABRIK iterations, before the chain's own solver refines them.
+static const int IK_MULTIRES_MIN_LINKS = 64;
+static const int IK_MULTIRES_LINKS_PER_GROUP = 16;
+static const int IK_MULTIRES_PROXY_ITERATIONS = 32;
+// Solver iterations between renormalizations of the links' rotation quaternions.
+static const int IK_RENORMALIZE_INTERVAL = 8;
+// Deadline solves predict a step by the slowest recent one, the prediction only shrinks by 1 / IK_STEP_TIME_DECAY a step.
+static const int IK_STEP_TIME_DECAY = 8;
+
+// The algorithms a chain can be solved with.
+enum IKSolverType
+{
+	IK_SOLVER_CCD,
+	IK_SOLVER_FABRIK,
+	IK_SOLVER_JACOBIAN_TRANSPOSE,
+	IK_SOLVER_JACOBIAN_DLS,
+	IK_SOLVER_JACOBI_CCD
+};
+
+// How much of every CCD correction is applied.
+enum IKStepPolicy
+{
+	IK_STEP_FIXED,		// Every correction divided by the angle size factor.
+	IK_STEP_ADAPTIVE	// Every correction limited by a trust region that follows the solve's progress.
+};
+
+// Outcome of a solve, the number of solver iterations run and the remaining distance between the chain's end and the target.
+struct IKSolveResult
+{
+	int iterations;
+	float residual;
+	bool isReachable;
+};
+
+// The local state of a single link, all the matrices a link contributes to the forward kinematics kept next to each other.
+struct IKLink
+{
+	mat4 translation;
+
+	// The solvers' rotation around the link's joint, a unit quaternion.
+	quat rotation;
+
+	// ZXZ Euler Angles as three successive rotations around z, x, and z axes, set by the user.
+	mat4 rotateZ2;
+	mat4 rotateX;
+	mat4 rotateZ;
+};
+
+/*
+* IKChain
+*
+* Headless inverse kinematics core, a chain of links with its forward kinematics and the CCD, FABRIK and Jacobian solvers.
+* Only depends on glm, so it can run without a window or a GL context.
+* Every link's transformation represents its middle, and every link rotates around its bottom point (the joint).
+* The number of links is chosen at construction, the links are stored in contiguous arrays that are never resized.
+*/
+class IKChain
+{
+	public:
+		IKChain(int numOfLinks, vec3 basePosition, float linkLength);
+
+		// Chain setup.
+		void reset();
+		void setBasePosition(vec3 position);
+		void translateBase(vec3 translation);
+		void setEndEffectorOffset(vec3 offset);
+		void rotateLinkX(int index, float angle);
+		void rotateLinkZ(int index, float angle);
+		void setSolverType(IKSolverType solverType);
+		IKSolverType getSolverType();
+		void setAnalyticEnabled(bool isEnabled);
+		void setStretchEnabled(bool isEnabled);
+		void setMultiResolutionEnabled(bool isEnabled);
+		void setTaskScheduler(IKTaskScheduler* scheduler);
+		void setStepPolicy(IKStepPolicy stepPolicy);
+		void setAngleSizeFactor(int angleSizeFactor);
+		void setJointStiffness(int index, float stiffness);
+		void setPoleVector(vec3 pole);
+		quat getLinkRotation(int index);
+		void setLinkRotation(int index, quat rotation);
+
+		int getNumOfLinks();
+		float getLinkLength();
+		float getMaxLength();
+		vec3 getEndEffectorOffset();
+
+		// Forward kinematics.
+		void updateTransformations();
+		const mat4* getLinkTransformations();
+		mat4 getLinkTransformation(int index);
+		vec3 getLinkBottomPoint(int index);
+		vec3 getBasePosition();
+		vec3 getEndEffectorPoint();
+
+		// Solving.
+		IKSolveResult solve(vec3 targetPoint, int maxIterations, float tolerance);
+		IKSolveResult solveUntil(vec3 targetPoint, IKClock::time_point deadline, float tolerance);
+		IKSolveResult resumeSolve(vec3 targetPoint, int maxIterations, float tolerance);
+		IKSolveResult stretchTowards(vec3 targetPoint);
+
+	private:
+		IKSolveResult runSolve(vec3 targetPoint, int maxIterations, float tolerance, IKClock::time_point deadline, bool isResumed);
+		void runIteration(vec3 targetPoint);
+		void runCCDSweep(vec3 targetPoint);
+		void runAdaptiveCCDSweep(vec3 targetPoint);
+		void runJacobiCCDSweep(vec3 targetPoint);
+		void runJacobiCCDJoints(int begin, int end, vec3 endEffector, vec3 targetPoint, float damping);
+		void runFABRIKIteration(vec3 targetPoint);
+		void runJacobianIteration(vec3 targetPoint);
+		void runAnalyticSolve(vec3 targetPoint);
+		void runMultiResolutionSolve(vec3 targetPoint, float tolerance, IKClock::time_point deadline);
+		void buildJacobian();
+		void applyJointPositions(const vec3* jointPositions);
+		bool rotateLinkInWorld(int index, vec3 from, vec3 to, float fraction);
+		void markDirty(int index);
+		void updateTransformations(int lastIndex);
+		mat4 getLinkLocalTransformation(const IKLink& link);
+		void normalizeRotations();
+		vec3 getLinkBone(int index);
+
+		int m_numOfLinks;
+		std::vector<IKLink> m_links;
+		std::vector<mat4> m_linkTransformations;
+
+		// Forward kinematics cache, the links from m_firstDirtyLink up are stale (m_numOfLinks when all up to date).
+		int m_firstDirtyLink;
+
+		// FABRIK's joint positions, the bottom of every link and the end effector.
+		std::vector<vec3> m_jointPositions;
+		std::vector<float> m_boneLengths;
+
+		// The sum of the bone lengths, the furthest the end effector can get from the base.
+		float m_maxLength;
+
+		// Jacobian solvers' 3 x (IK_JOINT_AXES * m_numOfLinks) matrix, a world column per joint axis,
+		// the matching axes in the frames the links' rotations are applied in, and the angles step.
+		std::vector<vec3> m_jacobian;
+		std::vector<vec3> m_jacobianAxes;
+		std::vector<float> m_jointAnglesStep;
+
+		mat4 m_linkBottomPoint, m_linkTopPoint;
+
+		float m_linkLength;
+		vec3 m_endEffectorOffset;
+
+		// CCD step policy, the per joint weights are 1 - stiffness, and the adaptive policy's trust region with the
+		// rotations saved before every sweep so a sweep that made things worse can be undone.
+		IKStepPolicy m_stepPolicy;
+		int m_angleSizeFactor;
+		std::vector<float> m_jointWeights;
+		std::vector<quat> m_savedRotations;
+
+		// Deadline solves, the rotations of the pose with the lowest residual seen so far, and the time the last iteration
+		// and the last multi-resolution stage took, kept across solves so even the first step of a solve is predicted.
+		std::vector<quat> m_bestRotations;
+		IKClock::duration m_iterationTime, m_multiResolutionTime;
+		float m_trustRatio, m_trustRadius;
+		IKSolverType m_solverType;
+
+		// Closed form solve for short chains, the pole is the point the chain bends towards (zero to keep the current bend).
+		bool m_isAnalyticEnabled;
+		vec3 m_poleVector;
+
+		// Out of reach targets, straighten the chain towards them instead of leaving it where it is.
+		bool m_isStretchEnabled;
+		int m_iterationsSinceNormalize;
+
+		// Jacobi CCD, the current damping and the optional workers for very long chains.
+		float m_jacobiDamping;
+		IKTaskScheduler* m_taskScheduler;
+
+		// Multi-resolution solve, the proxy chain's joints (the bottom of every group's first link and the end effector),
+		// every group's segment before the proxy solve and its world rotation found by the proxy solve.
+		bool m_isMultiResolutionEnabled;
+		int m_numOfGroups;
+		std::vector<vec3> m_proxyPoints;
+		std::vector<vec3> m_groupSegments;
+		std::vector<quat> m_groupRotations;
+};
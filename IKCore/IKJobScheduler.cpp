@@ -0,0 +1,307 @@
+#include "IKJobScheduler.h"
+#include <algorithm>
+
+/*
+* isLater
+*
+* @tbrief The queue's order, higher rank first and earliest deadline first within a rank. Within a rank the jobs that
+* already missed their deadline come after the ones that can still make it, so an overload doesn't spread to them.
+* A queued job's miss and rank only change in runUntil, which rebuilds the heap after it, otherwise they only change
+* while the job is out of the queue.
+*/
+static bool isLater(const IKSolveJob* job, const IKSolveJob* other)
+{
+	if (job->rank != other->rank)
+	{
+		return job->rank < other->rank;
+	}
+	if (job->isMissed != other->isMissed)
+	{
+		return job->isMissed;
+	}
+	if (job->deadline != other->deadline)
+	{
+		return job->deadline > other->deadline;
+	}
+	return false;
+}
+
+/*
+* IKJobScheduler
+*
+* @tparam capacity The maximal number of jobs queued at once.
+* @tparam numOfWorkers Number of workers including the calling thread, 0 for one per hardware thread.
+*/
+IKJobScheduler::IKJobScheduler(int capacity, int numOfWorkers)
+{
+	if (numOfWorkers <= 0)
+	{
+		numOfWorkers = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	m_capacity = capacity;
+	m_numOfWorkers = numOfWorkers;
+	m_queue.reserve(capacity);
+
+	m_runId = 0;
+	m_numOfBusyWorkers = 0;
+	m_isStopping = false;
+	m_numOfPreemptions = 0;
+	for (int i = 0; i < IK_JOB_NUM_OF_PRIORITIES; i++)
+	{
+		m_numOfCompletedJobs[i] = 0;
+		m_numOfMisses[i] = 0;
+	}
+
+	// Worker 0 is the thread calling runUntil.
+	for (int i = 1; i < numOfWorkers; i++)
+	{
+		m_threads.push_back(std::thread(&IKJobScheduler::workerLoop, this, i));
+	}
+}
+
+IKJobScheduler::~IKJobScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isStopping = true;
+	}
+	m_runStarted.notify_all();
+
+	for (size_t i = 0; i < m_threads.size(); i++)
+	{
+		m_threads[i].join();
+	}
+}
+
+/*
+* submit
+*
+* @tbrief Queue a job, it runs in the next runUntil calls until it's done. Must not be called during a run.
+* @treturn false if the queue is full, the job isn't queued.
+*/
+bool IKJobScheduler::submit(IKSolveJob* job)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if ((int)m_queue.size() >= m_capacity)
+	{
+		return false;
+	}
+
+	job->result.iterations = 0;
+	job->result.residual = distance(job->targetPoint, job->chain->getEndEffectorPoint());
+	job->result.isReachable = true;
+	job->isDone = false;
+	job->isMissed = false;
+	job->rank = job->priority;
+	job->waitingSince = IKClock::now();
+	pushJob(job);
+	return true;
+}
+
+/*
+* runUntil
+*
+* @tbrief Run the queued jobs on all the workers, return once the queue is empty or at the return time.
+* Jobs that are still running at the return time finish their slice and go back to the queue.
+* The queued jobs' misses and ranks are brought up to date first, a job that waited past its deadline is counted as a miss.
+*/
+void IKJobScheduler::runUntil(IKClock::time_point returnTime)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_queue.empty())
+		{
+			return;
+		}
+
+		IKClock::time_point now = IKClock::now();
+		for (size_t i = 0; i < m_queue.size(); i++)
+		{
+			updateJob(m_queue[i], now);
+		}
+		std::make_heap(m_queue.begin(), m_queue.end(), isLater);
+
+		m_returnTime = returnTime;
+		m_numOfBusyWorkers = m_numOfWorkers - 1;
+		m_runId++;
+	}
+	m_runStarted.notify_all();
+
+	runJobs();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_runFinished.wait(lock, [this] { return m_numOfBusyWorkers == 0; });
+}
+
+int IKJobScheduler::getNumOfQueuedJobs()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return (int)m_queue.size();
+}
+
+int IKJobScheduler::getNumOfWorkers()
+{
+	return m_numOfWorkers;
+}
+
+int IKJobScheduler::getNumOfCompletedJobs(IKJobPriority priority)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_numOfCompletedJobs[priority];
+}
+
+int IKJobScheduler::getNumOfMisses(IKJobPriority priority)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_numOfMisses[priority];
+}
+
+int IKJobScheduler::getNumOfPreemptions()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_numOfPreemptions;
+}
+
+/*
+* workerLoop
+*
+* @tbrief A worker thread, sleeps until a run starts, takes part in it and reports when it's done.
+*/
+void IKJobScheduler::workerLoop(int /*workerIndex*/)
+{
+	int lastRunId = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_runStarted.wait(lock, [this, lastRunId] { return m_isStopping || m_runId != lastRunId; });
+			if (m_isStopping)
+			{
+				return;
+			}
+			lastRunId = m_runId;
+		}
+
+		runJobs();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_numOfBusyWorkers--;
+		}
+		m_runFinished.notify_one();
+	}
+}
+
+/*
+* runJobs
+*
+* @tbrief Take the most urgent job and run it slice by slice. Between slices the job is finished, handed back at the
+* return time, or swapped for a more urgent job, one of a higher rank or, once it missed its deadline, one of its
+* own rank that can still make it.
+* Returns once there's nothing left to run.
+*/
+void IKJobScheduler::runJobs()
+{
+	IKSolveJob* job = NULL;
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			IKClock::time_point now = IKClock::now();
+			if (job)
+			{
+				// It just ran a slice, it's back to its own priority.
+				job->waitingSince = now;
+				updateJob(job, now);
+				if (job->isDone)
+				{
+					m_numOfCompletedJobs[job->priority]++;
+					job = NULL;
+				}
+				else if (now >= m_returnTime)
+				{
+					pushJob(job);
+					job = NULL;
+				}
+				else if (!m_queue.empty() && isLater(job, m_queue.front()))
+				{
+					pushJob(job);
+					job = popJob();
+					m_numOfPreemptions++;
+				}
+			}
+
+			// The next job, a job found past its deadline goes back behind the jobs of its rank that can still make it.
+			while (!job)
+			{
+				if (m_queue.empty() || (now >= m_returnTime))
+				{
+					return;
+				}
+				job = popJob();
+				if (updateJob(job, now) && !m_queue.empty() && isLater(job, m_queue.front()))
+				{
+					pushJob(job);
+					job = NULL;
+				}
+			}
+		}
+
+		// A slice, the first one sets the solve up and the next ones carry on from the pose and step sizes it left.
+		int sliceIterations = std::min(IK_JOB_SLICE_ITERATIONS, job->maxIterations - job->result.iterations);
+		IKSolveResult slice = (job->result.iterations == 0) ?
+			job->chain->solve(job->targetPoint, sliceIterations, job->tolerance) :
+			job->chain->resumeSolve(job->targetPoint, sliceIterations, job->tolerance);
+		job->result.iterations += slice.iterations;
+		job->result.residual = slice.residual;
+		job->result.isReachable = slice.isReachable;
+
+		// Nothing left to do once converged, out of reach or out of iterations (a slice that ran nothing can't get further).
+		job->isDone = (slice.residual <= job->tolerance) || !slice.isReachable ||
+			(job->result.iterations >= job->maxIterations) || (slice.iterations == 0);
+	}
+}
+
+/*
+* updateJob
+*
+* @tbrief Age a job's rank by the time it waited and mark it as missed once it's past its deadline, called under the mutex
+* for a job that is out of the queue, or for all the queued jobs before the heap is rebuilt.
+* @treturn true if the job has just missed its deadline.
+*/
+bool IKJobScheduler::updateJob(IKSolveJob* job, IKClock::time_point now)
+{
+	int agedRanks = (int)((now - job->waitingSince) / std::chrono::microseconds(IK_JOB_AGING_MICROSECONDS));
+	job->rank = std::min(job->priority + agedRanks, (int)IK_JOB_NUM_OF_PRIORITIES);
+	if (job->isMissed || (now <= job->deadline))
+	{
+		return false;
+	}
+	job->isMissed = true;
+	m_numOfMisses[job->priority]++;
+	return true;
+}
+
+/*
+* pushJob
+*
+* @tbrief Add a job to the queue's heap, called under the mutex.
+*/
+void IKJobScheduler::pushJob(IKSolveJob* job)
+{
+	m_queue.push_back(job);
+	std::push_heap(m_queue.begin(), m_queue.end(), isLater);
+}
+
+/*
+* popJob
+*
+* @tbrief Take the most urgent job off the queue's heap, called under the mutex.
+*/
+IKSolveJob* IKJobScheduler::popJob()
+{
+	std::pop_heap(m_queue.begin(), m_queue.end(), isLater);
+	IKSolveJob* job = m_queue.back();
+	m_queue.pop_back();
+	return job;
+}
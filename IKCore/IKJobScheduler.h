@@ -0,0 +1,102 @@
+#pragma once
+
+#include "IKChain.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Solver iterations a job runs between checks for a more urgent job.
+static const int IK_JOB_SLICE_ITERATIONS = 4;
+
+// A queued job is ranked a priority higher for every this many microseconds it waited since it last ran.
+static const int IK_JOB_AGING_MICROSECONDS = 4000;
+
+// How much a solve job matters, a job on time never waits for a job of a lower priority.
+enum IKJobPriority
+{
+	IK_JOB_PRIORITY_BACKGROUND,
+	IK_JOB_PRIORITY_NORMAL,
+	IK_JOB_PRIORITY_CRITICAL,
+	IK_JOB_NUM_OF_PRIORITIES
+};
+
+// A solve request, owned by the caller and filled in by the scheduler.
+// The chain must not be used by anything else until the job is done. Chains of several jobs may share an IKTaskScheduler,
+// their parallel sweeps then run one at a time.
+struct IKSolveJob
+{
+	IKChain* chain;
+	vec3 targetPoint;
+	int maxIterations;
+	float tolerance;
+	IKJobPriority priority;
+	IKClock::time_point deadline;
+
+	// Filled in by the scheduler, the iterations and residual so far, whether it's done and whether it missed its deadline,
+	// the priority it's ranked at in the queue (up to IK_JOB_NUM_OF_PRIORITIES, above every priority, once it aged)
+	// and when it was submitted or last ran.
+	IKSolveResult result;
+	bool isDone;
+	bool isMissed;
+	int rank;
+	IKClock::time_point waitingSince;
+};
+
+/*
+* IKJobScheduler
+*
+* Runs solve jobs of many chains on a pool of worker threads, higher rank first and earliest deadline first within
+* a rank. A job's rank is its priority, aged a rank higher for every IK_JOB_AGING_MICROSECONDS it waited since it last
+* ran, up to a rank above every priority. An aged job runs a slice and drops back to its priority, so a steady stream
+* of critical jobs can't starve the background ones, and the background ones only take a slice each per aging.
+* Jobs run in slices of IK_JOB_SLICE_ITERATIONS iterations, between slices a job goes back to the queue if a job of
+* a higher rank is waiting, so background chains can't hold up critical ones.
+* Every run is bounded by a return time, jobs that didn't finish stay queued and carry on in the next run.
+* A job is recorded as a miss once its deadline passes before it's done, whether it's running or queued, and from then
+* on it only runs when no job of its rank that can still make its deadline is waiting, so an overload doesn't make the
+* on time jobs miss as well.
+* The calling thread takes part in every run as worker 0.
+*/
+class IKJobScheduler
+{
+	public:
+		IKJobScheduler(int capacity, int numOfWorkers = 0);
+		~IKJobScheduler();
+
+		bool submit(IKSolveJob* job);
+		void runUntil(IKClock::time_point returnTime);
+
+		int getNumOfQueuedJobs();
+		int getNumOfWorkers();
+		int getNumOfCompletedJobs(IKJobPriority priority);
+		int getNumOfMisses(IKJobPriority priority);
+		int getNumOfPreemptions();
+
+	private:
+		void workerLoop(int workerIndex);
+		void runJobs();
+		bool updateJob(IKSolveJob* job, IKClock::time_point now);
+		void pushJob(IKSolveJob* job);
+		IKSolveJob* popJob();
+
+		int m_capacity;
+		int m_numOfWorkers;
+		std::vector<std::thread> m_threads;
+
+		// The queued jobs, a heap with the most urgent job on top, reserved at construction.
+		std::vector<IKSolveJob*> m_queue;
+
+		// The current run, published to the workers under the mutex.
+		std::mutex m_mutex;
+		std::condition_variable m_runStarted;
+		std::condition_variable m_runFinished;
+		IKClock::time_point m_returnTime;
+		int m_runId;
+		int m_numOfBusyWorkers;
+		bool m_isStopping;
+
+		int m_numOfCompletedJobs[IK_JOB_NUM_OF_PRIORITIES];
+		int m_numOfMisses[IK_JOB_NUM_OF_PRIORITIES];
+		int m_numOfPreemptions;
+};
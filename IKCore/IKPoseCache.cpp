@@ -0,0 +1,272 @@
+#include "IKPoseCache.h"
+
+// Hash buckets for every entry, keeps the buckets mostly a single entry long.
+static const int BUCKETS_PER_ENTRY = 2;
+
+/*
+* IKPoseCache
+*
+* @tparam capacity The maximal number of poses kept, the least recently used pose is replaced when it's full.
+* @tparam numOfLinks The number of links of the chains the poses are of.
+* @tparam cellSize The quantization of the target and base positions, targets in the same cell share an entry.
+*/
+IKPoseCache::IKPoseCache(int capacity, int numOfLinks, float cellSize)
+{
+	m_numOfLinks = numOfLinks;
+	m_cellSize = cellSize;
+	m_entries.resize(capacity);
+	m_rotations.resize(capacity * numOfLinks);
+
+	int numOfBuckets = 1;
+	while (numOfBuckets < capacity * BUCKETS_PER_ENTRY)
+	{
+		numOfBuckets *= 2;
+	}
+	m_buckets.resize(numOfBuckets);
+	clear();
+}
+
+void IKPoseCache::clear()
+{
+	int numOfEntries = (int)m_entries.size();
+	for (int i = 0; i < numOfEntries; i++)
+	{
+		m_entries[i].isValid = false;
+		m_entries[i].nextInBucket = -1;
+		m_entries[i].newer = i - 1;
+		m_entries[i].older = (i + 1 < numOfEntries) ? i + 1 : -1;
+	}
+	for (size_t i = 0; i < m_buckets.size(); i++)
+	{
+		m_buckets[i] = -1;
+	}
+	m_newest = (numOfEntries > 0) ? 0 : -1;
+	m_oldest = numOfEntries - 1;
+	m_numOfHits = 0;
+	m_numOfMisses = 0;
+}
+
+int IKPoseCache::getNumOfHits()
+{
+	return m_numOfHits;
+}
+
+int IKPoseCache::getNumOfMisses()
+{
+	return m_numOfMisses;
+}
+
+ivec3 IKPoseCache::quantize(vec3 point)
+{
+	return ivec3(floor(point / m_cellSize));
+}
+
+/*
+* getBucket
+*
+* @treturn The hash bucket of the given keys.
+*/
+int IKPoseCache::getBucket(ivec3 targetKey, ivec3 baseKey)
+{
+	unsigned int hash = (unsigned int)targetKey.x * 73856093u ^ (unsigned int)targetKey.y * 19349663u ^ (unsigned int)targetKey.z * 83492791u;
+	hash = hash * 31u + ((unsigned int)baseKey.x * 73856093u ^ (unsigned int)baseKey.y * 19349663u ^ (unsigned int)baseKey.z * 83492791u);
+	return (int)(hash & (unsigned int)(m_buckets.size() - 1));
+}
+
+/*
+* findEntry
+*
+* @treturn The index of the entry with the given keys, -1 if there is none.
+*/
+int IKPoseCache::findEntry(ivec3 targetKey, ivec3 baseKey)
+{
+	for (int i = m_buckets[getBucket(targetKey, baseKey)]; i >= 0; i = m_entries[i].nextInBucket)
+	{
+		const Entry& entry = m_entries[i];
+		if (entry.targetKey == targetKey && entry.baseKey == baseKey)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+* removeFromBucket
+*
+* @tbrief Unlink a valid entry from its hash bucket, before its keys are replaced.
+*/
+void IKPoseCache::removeFromBucket(int index)
+{
+	int* link = &m_buckets[getBucket(m_entries[index].targetKey, m_entries[index].baseKey)];
+	while (*link != index)
+	{
+		link = &m_entries[*link].nextInBucket;
+	}
+	*link = m_entries[index].nextInBucket;
+}
+
+/*
+* markUsed
+*
+* @tbrief Move an entry to the most recently used end of the LRU list.
+*/
+void IKPoseCache::markUsed(int index)
+{
+	if (index == m_newest)
+	{
+		return;
+	}
+
+	Entry& entry = m_entries[index];
+	m_entries[entry.newer].older = entry.older;
+	if (entry.older >= 0)
+	{
+		m_entries[entry.older].newer = entry.newer;
+	}
+	else
+	{
+		m_oldest = entry.newer;
+	}
+
+	entry.newer = -1;
+	entry.older = m_newest;
+	m_entries[m_newest].newer = index;
+	m_newest = index;
+}
+
+/*
+* warmStart
+*
+* @tbrief Seed the chain with the cached pose of the nearest target solved from the same base position, among the 2x2x2 cells
+* nearest to the new target (all the cells within half a cell of it), as long as that target is nearer to the new target
+* than the chain's current end is.
+* @treturn true if the chain was seeded.
+*/
+bool IKPoseCache::warmStart(IKChain& chain, vec3 targetPoint)
+{
+	vec3 cellPoint = targetPoint / m_cellSize;
+	ivec3 firstKey = ivec3(floor(cellPoint - vec3(0.5f)));
+	ivec3 baseKey = quantize(chain.getBasePosition());
+	float nearestDistance = distance(chain.getEndEffectorPoint(), targetPoint);
+	int nearestIndex = -1;
+	for (int z = 0; z <= 1; z++)
+	{
+		for (int y = 0; y <= 1; y++)
+		{
+			for (int x = 0; x <= 1; x++)
+			{
+				int index = findEntry(firstKey + ivec3(x, y, z), baseKey);
+				if (index >= 0 && distance(m_entries[index].targetPoint, targetPoint) < nearestDistance)
+				{
+					nearestDistance = distance(m_entries[index].targetPoint, targetPoint);
+					nearestIndex = index;
+				}
+			}
+		}
+	}
+
+	if (nearestIndex < 0)
+	{
+		m_numOfMisses++;
+		return false;
+	}
+
+	m_numOfHits++;
+	markUsed(nearestIndex);
+	const quat* rotations = &m_rotations[nearestIndex * m_numOfLinks];
+	for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+	{
+		chain.setLinkRotation(i, rotations[i]);
+	}
+	return true;
+}
+
+/*
+* store
+*
+* @tbrief Cache the chain's current pose as the pose that reaches the target, replacing the pose of the same cell
+* or else the least recently used pose.
+*/
+void IKPoseCache::store(IKChain& chain, vec3 targetPoint)
+{
+	if (m_entries.empty())
+	{
+		return;
+	}
+
+	ivec3 targetKey = quantize(targetPoint);
+	ivec3 baseKey = quantize(chain.getBasePosition());
+	int index = findEntry(targetKey, baseKey);
+	if (index < 0)
+	{
+		index = m_oldest;
+		Entry& entry = m_entries[index];
+		if (entry.isValid)
+		{
+			removeFromBucket(index);
+		}
+
+		int bucket = getBucket(targetKey, baseKey);
+		entry.targetKey = targetKey;
+		entry.baseKey = baseKey;
+		entry.nextInBucket = m_buckets[bucket];
+		entry.isValid = true;
+		m_buckets[bucket] = index;
+	}
+
+	m_entries[index].targetPoint = targetPoint;
+	markUsed(index);
+
+	quat* rotations = &m_rotations[index * m_numOfLinks];
+	for (int i = IK_BASE_LINK_INDEX; i < m_numOfLinks; i++)
+	{
+		rotations[i] = chain.getLinkRotation(i);
+	}
+}
+
+/*
+* solve
+*
+* @tbrief Solve the chain warm started from the cache, a converged pose is cached for the next solves.
+* See IKChain::solve.
+*/
+IKSolveResult IKPoseCache::solve(IKChain& chain, vec3 targetPoint, int maxIterations, float tolerance)
+{
+	// Already there, nothing to seed or to store.
+	if (distance(chain.getEndEffectorPoint(), targetPoint) <= tolerance)
+	{
+		return chain.solve(targetPoint, maxIterations, tolerance);
+	}
+
+	warmStart(chain, targetPoint);
+	IKSolveResult result = chain.solve(targetPoint, maxIterations, tolerance);
+	if (result.isReachable && result.residual <= tolerance)
+	{
+		store(chain, targetPoint);
+	}
+	return result;
+}
+
+/*
+* solveUntil
+*
+* @tbrief Solve the chain warm started from the cache until the deadline, a converged pose is cached for the next solves.
+* See IKChain::solveUntil.
+*/
+IKSolveResult IKPoseCache::solveUntil(IKChain& chain, vec3 targetPoint, IKClock::time_point deadline, float tolerance)
+{
+	// Already there, nothing to seed or to store.
+	if (distance(chain.getEndEffectorPoint(), targetPoint) <= tolerance)
+	{
+		return chain.solveUntil(targetPoint, deadline, tolerance);
+	}
+
+	warmStart(chain, targetPoint);
+	IKSolveResult result = chain.solveUntil(targetPoint, deadline, tolerance);
+	if (result.isReachable && result.residual <= tolerance)
+	{
+		store(chain, targetPoint);
+	}
+	return result;
+}
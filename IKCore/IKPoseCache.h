@@ -0,0 +1,59 @@
+#pragma once
+
+#include "IKChain.h"
+#include <vector>
+
+/*
+* IKPoseCache
+*
+* A small LRU cache of converged chain poses, keyed by the quantized target and base positions.
+* A solve is seeded from the cached pose whose target is nearest to the new target, among the poses of the cells within
+* half a cell of the new target, so repeated and slowly drifting targets converge in an iteration or two.
+* The entries are found through a hash table of their keys and kept in a list from the most to the least recently used,
+* so lookups and replacements cost the same whatever the capacity. All of it is allocated once, at construction.
+*/
+class IKPoseCache
+{
+	public:
+		IKPoseCache(int capacity, int numOfLinks, float cellSize);
+
+		void clear();
+		bool warmStart(IKChain& chain, vec3 targetPoint);
+		void store(IKChain& chain, vec3 targetPoint);
+		IKSolveResult solve(IKChain& chain, vec3 targetPoint, int maxIterations, float tolerance);
+		IKSolveResult solveUntil(IKChain& chain, vec3 targetPoint, IKClock::time_point deadline, float tolerance);
+
+		int getNumOfHits();
+		int getNumOfMisses();
+
+	private:
+		// A cached pose's keys, the next entry in its hash bucket and its neighbours in the LRU list (-1 for none),
+		// its links' rotations are at m_rotations[index * m_numOfLinks].
+		struct Entry
+		{
+			ivec3 targetKey;
+			ivec3 baseKey;
+			vec3 targetPoint;
+			int nextInBucket;
+			int newer, older;
+			bool isValid;
+		};
+
+		ivec3 quantize(vec3 point);
+		int getBucket(ivec3 targetKey, ivec3 baseKey);
+		int findEntry(ivec3 targetKey, ivec3 baseKey);
+		void removeFromBucket(int index);
+		void markUsed(int index);
+
+		int m_numOfLinks;
+		float m_cellSize;
+		std::vector<Entry> m_entries;
+		std::vector<quat> m_rotations;
+
+		// The first entry of every hash bucket, -1 for an empty bucket, a power of two buckets.
+		std::vector<int> m_buckets;
+
+		// The ends of the LRU list, invalid entries are kept at the least recently used end.
+		int m_newest, m_oldest;
+		int m_numOfHits, m_numOfMisses;
+};
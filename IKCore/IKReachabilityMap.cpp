@@ -0,0 +1,355 @@
+#include "IKReachabilityMap.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The seeds section starts after the flags padded to this many bytes, so the floats stay aligned.
+static const size_t FLAGS_ALIGNMENT = 16;
+
+static uint64_t getFlagsSize(uint64_t numOfVoxels)
+{
+	return (numOfVoxels + FLAGS_ALIGNMENT - 1) / FLAGS_ALIGNMENT * FLAGS_ALIGNMENT;
+}
+
+IKReachabilityMap::IKReachabilityMap()
+{
+	m_data = NULL;
+	m_size = 0;
+	m_header = NULL;
+	m_reachable = NULL;
+	m_seeds = NULL;
+	m_file = NULL;
+	m_mapping = NULL;
+	m_fileDescriptor = -1;
+}
+
+IKReachabilityMap::~IKReachabilityMap()
+{
+	close();
+}
+
+/*
+* getExtent
+*
+* @tbrief Half the side of the grid's cube, the furthest the end of the chain can get from its base.
+*/
+float IKReachabilityMap::getExtent(IKChain& chain)
+{
+	return chain.getMaxLength();
+}
+
+/*
+* build
+*
+* @tbrief Build the map of a chain offline and write it to a file. Every voxel's center is solved for, starting from the
+* pose of the previous voxel in the row (or the row below) when it was reachable so neighbouring seeds stay coherent,
+* and from the straight pose otherwise. The voxel is reachable if a solve gets within half a voxel of its center.
+* The chain is left in the last solved pose.
+* @tparam chain The chain definition, its number of links, link length, end effector offset and solver.
+* @tparam resolution The number of voxels along each axis.
+* @tparam maxIterations The iterations budget of every voxel's solve.
+* @tparam path The file to write.
+* @treturn false if the resolution is out of range or the file couldn't be written.
+*/
+bool IKReachabilityMap::build(IKChain& chain, int resolution, int maxIterations, const char* path)
+{
+	if (resolution <= 0 || resolution > IK_REACHABILITY_MAP_MAX_RESOLUTION)
+	{
+		return false;
+	}
+
+	int numOfLinks = chain.getNumOfLinks();
+	int numOfVoxels = resolution * resolution * resolution;
+	float extent = getExtent(chain);
+	float voxelSize = 2 * extent / resolution;
+	vec3 basePosition = chain.getBasePosition();
+
+	IKReachabilityMapHeader header;
+	memcpy(header.magic, IK_REACHABILITY_MAP_MAGIC, sizeof(header.magic));
+	header.version = IK_REACHABILITY_MAP_VERSION;
+	header.numOfLinks = numOfLinks;
+	header.resolution = resolution;
+	header.linkLength = chain.getLinkLength();
+	header.extent = extent;
+	vec3 offset = chain.getEndEffectorOffset();
+	header.endEffectorOffset[0] = offset.x;
+	header.endEffectorOffset[1] = offset.y;
+	header.endEffectorOffset[2] = offset.z;
+	header.padding = 0;
+
+	std::vector<unsigned char> reachable((size_t)getFlagsSize(numOfVoxels), 0);
+	std::vector<float> seeds((size_t)numOfVoxels * numOfLinks * 4, 0.0f);
+
+	for (int z = 0; z < resolution; z++)
+	{
+		for (int y = 0; y < resolution; y++)
+		{
+			for (int x = 0; x < resolution; x++)
+			{
+				int index = (z * resolution + y) * resolution + x;
+				vec3 center = basePosition + (vec3(x, y, z) + vec3(0.5f)) * voxelSize - vec3(extent);
+
+				// Seed from a reachable neighbour that was already solved.
+				int neighbourIndex = (x > 0 && reachable[index - 1]) ? index - 1 : ((y > 0 && reachable[index - resolution]) ? index - resolution : -1);
+				bool isSeeded = false;
+				if (neighbourIndex >= 0)
+				{
+					const float* seed = &seeds[(size_t)neighbourIndex * numOfLinks * 4];
+					for (int i = IK_BASE_LINK_INDEX; i < numOfLinks; i++)
+					{
+						chain.setLinkRotation(i, quat(seed[4 * i + 3], seed[4 * i], seed[4 * i + 1], seed[4 * i + 2]));
+					}
+					isSeeded = true;
+				}
+				else
+				{
+					chain.reset();
+				}
+
+				IKSolveResult result = chain.solve(center, maxIterations, voxelSize / 2);
+				if (result.isReachable && result.residual > voxelSize / 2 && isSeeded)
+				{
+					// The neighbour's pose led nowhere, try again from the straight pose.
+					chain.reset();
+					result = chain.solve(center, maxIterations, voxelSize / 2);
+				}
+
+				if (result.isReachable && result.residual <= voxelSize / 2)
+				{
+					reachable[index] = 1;
+					float* seed = &seeds[(size_t)index * numOfLinks * 4];
+					for (int i = IK_BASE_LINK_INDEX; i < numOfLinks; i++)
+					{
+						quat rotation = normalize(chain.getLinkRotation(i));
+						seed[4 * i] = rotation.x;
+						seed[4 * i + 1] = rotation.y;
+						seed[4 * i + 2] = rotation.z;
+						seed[4 * i + 3] = rotation.w;
+					}
+				}
+			}
+		}
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)&reachable[0], reachable.size());
+	file.write((const char*)&seeds[0], seeds.size() * sizeof(float));
+	return file.good();
+}
+
+/*
+* open
+*
+* @tbrief Memory map a map file, the pages are only read from the disk when they're looked up.
+* @treturn false if the file doesn't exist or isn't a valid map.
+*/
+bool IKReachabilityMap::open(const char* path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	m_file = file;
+
+	LARGE_INTEGER size;
+	HANDLE mapping = GetFileSizeEx(file, &size) ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	if (mapping == NULL)
+	{
+		close();
+		return false;
+	}
+	m_mapping = mapping;
+	m_size = (size_t)size.QuadPart;
+	m_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	m_fileDescriptor = ::open(path, O_RDONLY);
+	if (m_fileDescriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(m_fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		close();
+		return false;
+	}
+	m_size = (size_t)fileStat.st_size;
+	m_data = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+	if (m_data == MAP_FAILED)
+	{
+		m_data = NULL;
+	}
+#endif
+
+	if (m_data == NULL || m_size < sizeof(IKReachabilityMapHeader))
+	{
+		close();
+		return false;
+	}
+
+	// Validate the header before any size is computed from it.
+	m_header = (const IKReachabilityMapHeader*)m_data;
+	if (memcmp(m_header->magic, IK_REACHABILITY_MAP_MAGIC, sizeof(m_header->magic)) != 0 || m_header->version != IK_REACHABILITY_MAP_VERSION ||
+		m_header->resolution <= 0 || m_header->resolution > IK_REACHABILITY_MAP_MAX_RESOLUTION || m_header->numOfLinks <= 0 ||
+		!(m_header->extent > 0))
+	{
+		close();
+		return false;
+	}
+
+	// The file must be exactly the sections the header describes. The sizes are computed in 64 bits and the seeds
+	// section is divided rather than multiplied, so a corrupt header can't overflow into a size that matches.
+	uint64_t numOfVoxels = (uint64_t)m_header->resolution * m_header->resolution * m_header->resolution;
+	uint64_t seedSize = (uint64_t)m_header->numOfLinks * 4 * sizeof(float);
+	uint64_t sectionsSize = sizeof(IKReachabilityMapHeader) + getFlagsSize(numOfVoxels);
+	uint64_t seedsSize = (m_size >= sectionsSize) ? m_size - sectionsSize : 0;
+	if (m_size < sectionsSize || seedsSize % seedSize != 0 || seedsSize / seedSize != numOfVoxels)
+	{
+		close();
+		return false;
+	}
+
+	m_reachable = (const unsigned char*)m_data + sizeof(IKReachabilityMapHeader);
+	m_seeds = (const float*)(m_reachable + getFlagsSize(numOfVoxels));
+	return true;
+}
+
+void IKReachabilityMap::close()
+{
+#ifdef _WIN32
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping)
+	{
+		CloseHandle((HANDLE)m_mapping);
+	}
+	if (m_file)
+	{
+		CloseHandle((HANDLE)m_file);
+	}
+#else
+	if (m_data)
+	{
+		munmap(m_data, m_size);
+	}
+	if (m_fileDescriptor >= 0)
+	{
+		::close(m_fileDescriptor);
+	}
+#endif
+
+	m_data = NULL;
+	m_size = 0;
+	m_header = NULL;
+	m_reachable = NULL;
+	m_seeds = NULL;
+	m_file = NULL;
+	m_mapping = NULL;
+	m_fileDescriptor = -1;
+}
+
+bool IKReachabilityMap::isOpen()
+{
+	return m_header != NULL;
+}
+
+/*
+* matches
+*
+* @tbrief Whether the map was built for a chain of the same definition.
+*/
+bool IKReachabilityMap::matches(IKChain& chain)
+{
+	if (!isOpen())
+	{
+		return false;
+	}
+	vec3 offset = chain.getEndEffectorOffset();
+	return m_header->numOfLinks == chain.getNumOfLinks() && m_header->linkLength == chain.getLinkLength() &&
+		m_header->endEffectorOffset[0] == offset.x && m_header->endEffectorOffset[1] == offset.y && m_header->endEffectorOffset[2] == offset.z;
+}
+
+/*
+* getVoxelIndex
+*
+* @treturn The index of the voxel the target is in, -1 if it's outside of the grid or not a finite point.
+*/
+int IKReachabilityMap::getVoxelIndex(vec3 basePosition, vec3 targetPoint)
+{
+	int resolution = m_header->resolution;
+	vec3 gridPoint = (targetPoint - basePosition + vec3(m_header->extent)) * (resolution / (2 * m_header->extent));
+
+	// Checked while it's still a float, a far away point doesn't fit in an int. NaN fails every comparison, so it's outside as well.
+	if (!(gridPoint.x >= 0 && gridPoint.y >= 0 && gridPoint.z >= 0 && gridPoint.x < resolution && gridPoint.y < resolution && gridPoint.z < resolution))
+	{
+		return -1;
+	}
+	ivec3 voxel = ivec3(floor(gridPoint));
+	return (voxel.z * resolution + voxel.y) * resolution + voxel.x;
+}
+
+vec3 IKReachabilityMap::getVoxelCenter(vec3 basePosition, int voxelIndex)
+{
+	int resolution = m_header->resolution;
+	vec3 voxel(voxelIndex % resolution, (voxelIndex / resolution) % resolution, voxelIndex / (resolution * resolution));
+	return basePosition + (voxel + vec3(0.5f)) * (2 * m_header->extent / resolution) - vec3(m_header->extent);
+}
+
+/*
+* isReachable
+*
+* @tbrief O(1) lookup of whether the chain standing on the base position can reach the target.
+* The map isn't checked against the chain on every lookup, the caller must check it with matches() after opening it.
+*/
+bool IKReachabilityMap::isReachable(vec3 basePosition, vec3 targetPoint)
+{
+	int index = getVoxelIndex(basePosition, targetPoint);
+	return index >= 0 && m_reachable[index];
+}
+
+/*
+* warmStart
+*
+* @tbrief Seed the chain with the pose of the target's voxel, as long as the map was built for a chain of as many links
+* and the voxel's center is nearer to the target than the chain's current end is.
+* @treturn true if the chain was seeded.
+*/
+bool IKReachabilityMap::warmStart(IKChain& chain, vec3 targetPoint)
+{
+	vec3 basePosition = chain.getBasePosition();
+	int index = getVoxelIndex(basePosition, targetPoint);
+	if (m_header->numOfLinks != chain.getNumOfLinks() || index < 0 || !m_reachable[index] || distance(getVoxelCenter(basePosition, index), targetPoint) >= distance(chain.getEndEffectorPoint(), targetPoint))
+	{
+		return false;
+	}
+
+	const float* seed = m_seeds + (size_t)index * m_header->numOfLinks * 4;
+	for (int i = IK_BASE_LINK_INDEX; i < m_header->numOfLinks; i++)
+	{
+		chain.setLinkRotation(i, quat(seed[4 * i + 3], seed[4 * i], seed[4 * i + 1], seed[4 * i + 2]));
+	}
+	return true;
+}
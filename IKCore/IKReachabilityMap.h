@@ -0,0 +1,68 @@
+#pragma once
+
+#include "IKChain.h"
+#include <cstddef>
+#include <cstdint>
+
+// Reachability map file, a header, a reachable flag per voxel (padded to 16 bytes) and a seed pose per voxel,
+// every seed is the chain's links' rotations as x, y, z, w quaternions.
+static const char IK_REACHABILITY_MAP_MAGIC[4] = { 'I', 'K', 'R', 'M' };
+static const int IK_REACHABILITY_MAP_VERSION = 1;
+
+// The largest resolution whose number of voxels still fits the int voxel indices.
+static const int IK_REACHABILITY_MAP_MAX_RESOLUTION = 1290;
+
+struct IKReachabilityMapHeader
+{
+	char magic[4];
+	int version;
+	int numOfLinks;
+	int resolution;
+	float linkLength;
+	float extent;
+	float endEffectorOffset[3];
+	int padding;
+};
+
+/*
+* IKReachabilityMap
+*
+* A voxel grid around the chain's base that tells which targets the chain can reach, with a seed pose per reachable voxel.
+* It's built offline by solving to every voxel's center, so it follows what the solver can actually reach rather than
+* a sphere, and is read back by memory mapping the file, a lookup is O(1) and nothing is loaded up front.
+* The grid is a cube of resolution^3 voxels with its center at the chain's base and half its side the chain's extent.
+* A map only answers for the chain it was built for, check it with matches() before looking targets up.
+*/
+class IKReachabilityMap
+{
+	public:
+		IKReachabilityMap();
+		~IKReachabilityMap();
+
+		static bool build(IKChain& chain, int resolution, int maxIterations, const char* path);
+
+		bool open(const char* path);
+		void close();
+		bool isOpen();
+		bool matches(IKChain& chain);
+
+		bool isReachable(vec3 basePosition, vec3 targetPoint);
+		bool warmStart(IKChain& chain, vec3 targetPoint);
+
+	private:
+		static float getExtent(IKChain& chain);
+		int getVoxelIndex(vec3 basePosition, vec3 targetPoint);
+		vec3 getVoxelCenter(vec3 basePosition, int voxelIndex);
+
+		// The mapped file and its sections.
+		void* m_data;
+		size_t m_size;
+		const IKReachabilityMapHeader* m_header;
+		const unsigned char* m_reachable;
+		const float* m_seeds;
+
+		// Platform mapping handles, Windows file and mapping handles or a POSIX file descriptor.
+		void* m_file;
+		void* m_mapping;
+		int m_fileDescriptor;
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+/*
+* IKSimdFloat
+*
+* A float per SIMD lane, IK_SIMD_WIDTH lanes wide. Compiles to AVX (8 lanes) when it's enabled, SSE (4 lanes) otherwise,
+* and falls back to a single scalar lane on other targets, so the batch kernels are written once for all of them.
+* Comparisons return lane masks that are used by select(), anyLane() and the mask operators.
+*/
+
+#if defined(__AVX__)
+
+#include <immintrin.h>
+
+#define IK_SIMD_WIDTH 8
+
+struct IKSimdFloat
+{
+	__m256 v;
+
+	IKSimdFloat() {}
+	IKSimdFloat(__m256 value) : v(value) {}
+	IKSimdFloat(float value) : v(_mm256_set1_ps(value)) {}
+
+	static IKSimdFloat load(const float* p) { return _mm256_loadu_ps(p); }
+	void store(float* p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline IKSimdFloat operator+(IKSimdFloat a, IKSimdFloat b) { return _mm256_add_ps(a.v, b.v); }
+inline IKSimdFloat operator-(IKSimdFloat a, IKSimdFloat b) { return _mm256_sub_ps(a.v, b.v); }
+inline IKSimdFloat operator*(IKSimdFloat a, IKSimdFloat b) { return _mm256_mul_ps(a.v, b.v); }
+inline IKSimdFloat operator/(IKSimdFloat a, IKSimdFloat b) { return _mm256_div_ps(a.v, b.v); }
+inline IKSimdFloat operator<(IKSimdFloat a, IKSimdFloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+inline IKSimdFloat operator>(IKSimdFloat a, IKSimdFloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+inline IKSimdFloat operator<=(IKSimdFloat a, IKSimdFloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+inline IKSimdFloat operator&(IKSimdFloat a, IKSimdFloat b) { return _mm256_and_ps(a.v, b.v); }
+inline IKSimdFloat operator|(IKSimdFloat a, IKSimdFloat b) { return _mm256_or_ps(a.v, b.v); }
+inline IKSimdFloat sqrt(IKSimdFloat a) { return _mm256_sqrt_ps(a.v); }
+inline IKSimdFloat max(IKSimdFloat a, IKSimdFloat b) { return _mm256_max_ps(a.v, b.v); }
+inline IKSimdFloat min(IKSimdFloat a, IKSimdFloat b) { return _mm256_min_ps(a.v, b.v); }
+inline IKSimdFloat select(IKSimdFloat mask, IKSimdFloat a, IKSimdFloat b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+inline bool anyLane(IKSimdFloat mask) { return _mm256_movemask_ps(mask.v) != 0; }
+
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#include <emmintrin.h>
+
+#define IK_SIMD_WIDTH 4
+
+struct IKSimdFloat
+{
+	__m128 v;
+
+	IKSimdFloat() {}
+	IKSimdFloat(__m128 value) : v(value) {}
+	IKSimdFloat(float value) : v(_mm_set1_ps(value)) {}
+
+	static IKSimdFloat load(const float* p) { return _mm_loadu_ps(p); }
+	void store(float* p) const { _mm_storeu_ps(p, v); }
+};
+
+inline IKSimdFloat operator+(IKSimdFloat a, IKSimdFloat b) { return _mm_add_ps(a.v, b.v); }
+inline IKSimdFloat operator-(IKSimdFloat a, IKSimdFloat b) { return _mm_sub_ps(a.v, b.v); }
+inline IKSimdFloat operator*(IKSimdFloat a, IKSimdFloat b) { return _mm_mul_ps(a.v, b.v); }
+inline IKSimdFloat operator/(IKSimdFloat a, IKSimdFloat b) { return _mm_div_ps(a.v, b.v); }
+inline IKSimdFloat operator<(IKSimdFloat a, IKSimdFloat b) { return _mm_cmplt_ps(a.v, b.v); }
+inline IKSimdFloat operator>(IKSimdFloat a, IKSimdFloat b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline IKSimdFloat operator<=(IKSimdFloat a, IKSimdFloat b) { return _mm_cmple_ps(a.v, b.v); }
+inline IKSimdFloat operator&(IKSimdFloat a, IKSimdFloat b) { return _mm_and_ps(a.v, b.v); }
+inline IKSimdFloat operator|(IKSimdFloat a, IKSimdFloat b) { return _mm_or_ps(a.v, b.v); }
+inline IKSimdFloat sqrt(IKSimdFloat a) { return _mm_sqrt_ps(a.v); }
+inline IKSimdFloat max(IKSimdFloat a, IKSimdFloat b) { return _mm_max_ps(a.v, b.v); }
+inline IKSimdFloat min(IKSimdFloat a, IKSimdFloat b) { return _mm_min_ps(a.v, b.v); }
+inline IKSimdFloat select(IKSimdFloat mask, IKSimdFloat a, IKSimdFloat b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+inline bool anyLane(IKSimdFloat mask) { return _mm_movemask_ps(mask.v) != 0; }
+
+#else
+
+#include <cmath>
+
+#define IK_SIMD_WIDTH 1
+
+// Scalar fallback, a mask is 1 for a set lane and 0 otherwise.
+struct IKSimdFloat
+{
+	float v;
+
+	IKSimdFloat() {}
+	IKSimdFloat(float value) : v(value) {}
+
+	static IKSimdFloat load(const float* p) { return *p; }
+	void store(float* p) const { *p = v; }
+};
+
+inline IKSimdFloat operator+(IKSimdFloat a, IKSimdFloat b) { return a.v + b.v; }
+inline IKSimdFloat operator-(IKSimdFloat a, IKSimdFloat b) { return a.v - b.v; }
+inline IKSimdFloat operator*(IKSimdFloat a, IKSimdFloat b) { return a.v * b.v; }
+inline IKSimdFloat operator/(IKSimdFloat a, IKSimdFloat b) { return a.v / b.v; }
+inline IKSimdFloat operator<(IKSimdFloat a, IKSimdFloat b) { return a.v < b.v ? 1.0f : 0.0f; }
+inline IKSimdFloat operator>(IKSimdFloat a, IKSimdFloat b) { return a.v > b.v ? 1.0f : 0.0f; }
+inline IKSimdFloat operator<=(IKSimdFloat a, IKSimdFloat b) { return a.v <= b.v ? 1.0f : 0.0f; }
+inline IKSimdFloat operator&(IKSimdFloat a, IKSimdFloat b) { return (a.v != 0 && b.v != 0) ? 1.0f : 0.0f; }
+inline IKSimdFloat operator|(IKSimdFloat a, IKSimdFloat b) { return (a.v != 0 || b.v != 0) ? 1.0f : 0.0f; }
+inline IKSimdFloat sqrt(IKSimdFloat a) { return std::sqrt(a.v); }
+inline IKSimdFloat max(IKSimdFloat a, IKSimdFloat b) { return a.v > b.v ? a.v : b.v; }
+inline IKSimdFloat min(IKSimdFloat a, IKSimdFloat b) { return a.v < b.v ? a.v : b.v; }
+inline IKSimdFloat select(IKSimdFloat mask, IKSimdFloat a, IKSimdFloat b) { return mask.v != 0 ? a : b; }
+inline bool anyLane(IKSimdFloat mask) { return mask.v != 0; }
+
+#endif
+
+// A vec3 per SIMD lane, stored as a structure of arrays.
+struct IKSimdVec3
+{
+	IKSimdFloat x, y, z;
+
+	IKSimdVec3() {}
+	IKSimdVec3(IKSimdFloat x, IKSimdFloat y, IKSimdFloat z) : x(x), y(y), z(z) {}
+};
+
+inline IKSimdVec3 operator+(const IKSimdVec3& a, const IKSimdVec3& b) { return IKSimdVec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline IKSimdVec3 operator-(const IKSimdVec3& a, const IKSimdVec3& b) { return IKSimdVec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline IKSimdVec3 operator*(const IKSimdVec3& a, IKSimdFloat s) { return IKSimdVec3(a.x * s, a.y * s, a.z * s); }
+inline IKSimdFloat dot(const IKSimdVec3& a, const IKSimdVec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline IKSimdVec3 cross(const IKSimdVec3& a, const IKSimdVec3& b) { return IKSimdVec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+inline IKSimdFloat length(const IKSimdVec3& a) { return sqrt(dot(a, a)); }
+inline IKSimdVec3 select(IKSimdFloat mask, const IKSimdVec3& a, const IKSimdVec3& b) { return IKSimdVec3(select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z)); }
+
+// A quaternion per SIMD lane, stored as a structure of arrays.
+struct IKSimdQuat
+{
+	IKSimdFloat x, y, z, w;
+
+	IKSimdQuat() {}
+	IKSimdQuat(IKSimdFloat x, IKSimdFloat y, IKSimdFloat z, IKSimdFloat w) : x(x), y(y), z(z), w(w) {}
+};
+
+inline IKSimdQuat operator*(const IKSimdQuat& a, const IKSimdQuat& b)
+{
+	return IKSimdQuat(
+		a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+		a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+		a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z);
+}
+
+inline IKSimdQuat conjugate(const IKSimdQuat& q) { return IKSimdQuat(IKSimdFloat(0.0f) - q.x, IKSimdFloat(0.0f) - q.y, IKSimdFloat(0.0f) - q.z, q.w); }
+inline IKSimdQuat select(IKSimdFloat mask, const IKSimdQuat& a, const IKSimdQuat& b) { return IKSimdQuat(select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z), select(mask, a.w, b.w)); }
+
+inline IKSimdQuat normalize(const IKSimdQuat& q)
+{
+	IKSimdFloat inverseLength = IKSimdFloat(1.0f) / sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+	return IKSimdQuat(q.x * inverseLength, q.y * inverseLength, q.z * inverseLength, q.w * inverseLength);
+}
+
+// Rotate a vector by a unit quaternion, v + 2w(q x v) + 2q x (q x v).
+inline IKSimdVec3 rotate(const IKSimdQuat& q, const IKSimdVec3& v)
+{
+	IKSimdVec3 axis(q.x, q.y, q.z);
+	IKSimdVec3 t = cross(axis, v) * IKSimdFloat(2.0f);
+	return v + t * q.w + cross(axis, t);
+}
+
+/*
+* rotationBetween
+*
+* The shortest rotation that takes the direction of a to the direction of b, computed without any trigonometry.
+* Lanes where the rotation is undefined (a zero vector or opposite directions) get the identity.
+*/
+inline IKSimdQuat rotationBetween(const IKSimdVec3& a, const IKSimdVec3& b)
+{
+	IKSimdFloat lengths = sqrt(dot(a, a) * dot(b, b));
+	IKSimdQuat q(0.0f, 0.0f, 0.0f, 0.0f);
+	IKSimdVec3 axis = cross(a, b);
+	q.x = axis.x;
+	q.y = axis.y;
+	q.z = axis.z;
+	q.w = lengths + dot(a, b);
+
+	IKSimdFloat normSquared = q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w;
+	IKSimdFloat isDefined = normSquared > lengths * lengths * IKSimdFloat(1e-12f);
+	IKSimdFloat inverseNorm = IKSimdFloat(1.0f) / sqrt(max(normSquared, IKSimdFloat(1e-30f)));
+	IKSimdQuat identity(0.0f, 0.0f, 0.0f, 1.0f);
+	return select(isDefined, IKSimdQuat(q.x * inverseNorm, q.y * inverseNorm, q.z * inverseNorm, q.w * inverseNorm), identity);
+}
@@ -0,0 +1,171 @@
+#include "IKTaskScheduler.h"
+#include <algorithm>
+
+/*
+* IKTaskScheduler
+*
+* @tparam numOfWorkers Number of workers including the calling thread, 0 for one per hardware thread.
+*/
+IKTaskScheduler::IKTaskScheduler(int numOfWorkers)
+{
+	if (numOfWorkers <= 0)
+	{
+		numOfWorkers = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+	m_numOfWorkers = numOfWorkers;
+	size_t rangesSize = sizeof(WorkerRange) * numOfWorkers;
+	size_t storageSize = rangesSize + alignof(WorkerRange);
+	m_rangeStorage.reset(new char[storageSize]);
+	void* ranges = m_rangeStorage.get();
+	std::align(alignof(WorkerRange), rangesSize, ranges, storageSize);
+	m_ranges = static_cast<WorkerRange*>(ranges);
+	for (int i = 0; i < numOfWorkers; i++)
+	{
+		new (&m_ranges[i]) WorkerRange();
+	}
+
+	m_function = NULL;
+	m_grainSize = 1;
+	m_loopId = 0;
+	m_numOfBusyWorkers = 0;
+	m_isStopping = false;
+
+	// Worker 0 is the thread calling parallelFor.
+	for (int i = 1; i < numOfWorkers; i++)
+	{
+		m_threads.push_back(std::thread(&IKTaskScheduler::workerLoop, this, i));
+	}
+}
+
+IKTaskScheduler::~IKTaskScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isStopping = true;
+	}
+	m_loopStarted.notify_all();
+
+	for (size_t i = 0; i < m_threads.size(); i++)
+	{
+		m_threads[i].join();
+	}
+}
+
+int IKTaskScheduler::getNumOfWorkers()
+{
+	return m_numOfWorkers;
+}
+
+/*
+* parallelFor
+*
+* @tbrief Run function on all the items [0, count) in chunks of grainSize items, and return once all of them are done.
+* Loops started from several threads at once run one after the other. Must not be called from a loop's function.
+* @tparam count Number of items.
+* @tparam grainSize Number of items taken at once, the last chunk of every worker's range may be smaller.
+* @tparam function Called once per chunk, with the chunk's items and the index of the worker running it.
+*/
+void IKTaskScheduler::parallelFor(int count, int grainSize, const RangeFunction& function)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	grainSize = std::max(1, grainSize);
+
+	// The ranges and the workers serve a single loop at a time, e.g. the long chains of several solve jobs share a scheduler.
+	std::lock_guard<std::mutex> loopLock(m_loopMutex);
+
+	// Split the items into one contiguous range per worker.
+	for (int i = 0; i < m_numOfWorkers; i++)
+	{
+		m_ranges[i].next.store((int)((long long)count * i / m_numOfWorkers), std::memory_order_relaxed);
+		m_ranges[i].end = (int)((long long)count * (i + 1) / m_numOfWorkers);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_function = &function;
+		m_grainSize = grainSize;
+		m_numOfBusyWorkers = m_numOfWorkers - 1;
+		m_loopId++;
+	}
+	m_loopStarted.notify_all();
+
+	runRanges(0);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_loopFinished.wait(lock, [this] { return m_numOfBusyWorkers == 0; });
+	m_function = NULL;
+}
+
+/*
+* workerLoop
+*
+* @tbrief A worker thread, sleeps until a loop starts, runs its part of it and reports when it's done.
+*/
+void IKTaskScheduler::workerLoop(int workerIndex)
+{
+	int lastLoopId = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_loopStarted.wait(lock, [this, lastLoopId] { return m_isStopping || m_loopId != lastLoopId; });
+			if (m_isStopping)
+			{
+				return;
+			}
+			lastLoopId = m_loopId;
+		}
+
+		runRanges(workerIndex);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_numOfBusyWorkers--;
+		}
+		m_loopFinished.notify_one();
+	}
+}
+
+/*
+* runRanges
+*
+* @tbrief Run chunks from the worker's own range, then steal chunks from the other workers until all the ranges are empty.
+*/
+void IKTaskScheduler::runRanges(int workerIndex)
+{
+	int begin, end;
+	for (int i = 0; i < m_numOfWorkers; i++)
+	{
+		int rangeIndex = (workerIndex + i) % m_numOfWorkers;
+		while (takeChunk(rangeIndex, begin, end))
+		{
+			(*m_function)(begin, end, workerIndex);
+		}
+	}
+}
+
+/*
+* takeChunk
+*
+* @tbrief Take the next chunk of items from a range, lock free, any worker may take chunks from any range.
+* @treturn false if the range is empty.
+*/
+bool IKTaskScheduler::takeChunk(int rangeIndex, int& begin, int& end)
+{
+	WorkerRange& range = m_ranges[rangeIndex];
+	if (range.next.load(std::memory_order_relaxed) >= range.end)
+	{
+		return false;
+	}
+
+	begin = range.next.fetch_add(m_grainSize, std::memory_order_relaxed);
+	if (begin >= range.end)
+	{
+		return false;
+	}
+	end = std::min(begin + m_grainSize, range.end);
+	return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Size of a cache line, the unit in which cores share memory.
+static const int IK_CACHE_LINE_SIZE = 64;
+
+/*
+* IKTaskScheduler
+*
+* A pool of worker threads that runs parallel loops with work stealing.
+* Every loop's items are split into one contiguous range per worker. A worker takes chunks from its own range first,
+* and once it's empty it steals chunks from the other workers' ranges. Chunks are taken with a single atomic add,
+* so there are no locks while the loop runs, a mutex is only taken to start and finish a loop.
+* The calling thread takes part in every loop as worker 0. Loops from several threads are serialized, a loop can't be nested in another.
+*/
+class IKTaskScheduler
+{
+	public:
+		// Runs the items [begin, end) on the given worker, workerIndex is in [0, getNumOfWorkers()).
+		typedef std::function<void(int begin, int end, int workerIndex)> RangeFunction;
+
+		IKTaskScheduler(int numOfWorkers = 0);
+		~IKTaskScheduler();
+
+		int getNumOfWorkers();
+		void parallelFor(int count, int grainSize, const RangeFunction& function);
+
+	private:
+		// A worker's range of items, aligned to its own cache line so workers don't slow each other down.
+		struct alignas(IK_CACHE_LINE_SIZE) WorkerRange
+		{
+			std::atomic<int> next;
+			int end;
+		};
+
+		void workerLoop(int workerIndex);
+		void runRanges(int workerIndex);
+		bool takeChunk(int rangeIndex, int& begin, int& end);
+
+		int m_numOfWorkers;
+		std::vector<std::thread> m_threads;
+		// The ranges, in storage over allocated by a cache line so they can start on a cache line boundary,
+		// operator new only guarantees the default alignment before C++17.
+		std::unique_ptr<char[]> m_rangeStorage;
+		WorkerRange* m_ranges;
+
+		// Held by the thread running a loop for the whole loop.
+		std::mutex m_loopMutex;
+
+		// The current loop, published to the workers under the mutex.
+		std::mutex m_mutex;
+		std::condition_variable m_loopStarted;
+		std::condition_variable m_loopFinished;
+		const RangeFunction* m_function;
+		int m_grainSize;
+		int m_loopId;
+		int m_numOfBusyWorkers;
+		bool m_isStopping;
+};
@@ -4,6 +4,9 @@ Cube::Cube(vec3 position, vec3 size, vec3 singleColor)
 {
 	initVertices(position, size, singleColor);
 	initIndices();
+
+	// Upload the cube's geometry once, the same buffers are drawn every frame.
+	m_mesh = new Mesh(m_vertices, 24, m_indices, sizeof(m_indices) / sizeof(m_indices[0]));
 }
 
 /**
@@ -71,9 +74,8 @@ void Cube::initIndices()
 */
 void Cube::initVertices(vec3 position, vec3 size, vec3 singleColor)
 {
-	// Every Vertex struct includes 3 vec3 and 1 vec2.
-	int vertexSize = sizeof(void *) * 3 * sizeof(vec3) + sizeof(vec2);
-	m_vertices = (Vertex*)malloc(24 * vertexSize);
+	// 4 vertices for each of the 6 faces.
+	m_vertices = (Vertex*)malloc(24 * sizeof(Vertex));
 
 	float x = position.x;
 	float y = position.y;
@@ -128,13 +130,22 @@ void Cube::initVertices(vec3 position, vec3 size, vec3 singleColor)
 	m_vertices[23] = Vertex(vec3(halfSizeX + x, halfSizeY + y, -halfSizeZ + z), vec2(0, 1), vec3(1, 0, 0), currentColor);
 }
 
-void Cube::draw()
+/**
+* Queue a draw of count cubes, each one placed by its own object's uniforms, drawn when the queue is executed.
+*
+* @param queue The frame's render queue.
+* @param shader The shader the cubes are drawn with.
+* @param texture The cubes' texture, 0 for none.
+* @param firstObject The first cube's object index, returned by UniformBuffers::AddObjects.
+* @param count Number of cubes to draw.
+*/
+void Cube::draw(RenderQueue* queue, Shader* shader, unsigned int texture, unsigned int firstObject, unsigned int count)
 {
-	Mesh mesh(m_vertices, 24, m_indices, sizeof(m_indices) / sizeof(m_indices[0]));
-	mesh.Draw();
+	queue->Add(shader, texture, m_mesh, firstObject, count);
 }
 
 Cube::~Cube()
 {
-	delete m_vertices;
+	delete m_mesh;
+	free(m_vertices);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mesh.h"
+#include "render_queue.h"
 
 using namespace glm;
 
@@ -8,7 +9,7 @@ class Cube
 {
 public:
 	Cube(vec3 position, vec3 size, vec3 singleColor = vec3(-1.0f));
-	void draw();
+	void draw(RenderQueue* queue, Shader* shader, unsigned int texture, unsigned int firstObject, unsigned int count);
 	~Cube();
 
 private:
@@ -17,4 +18,7 @@ private:
 
 	Vertex* m_vertices;
 	unsigned int m_indices[36];
+
+	// GPU geometry, created once in the constructor and reused by every draw call.
+	Mesh* m_mesh;
 };
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "GPUPicker.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+/*
+* GPUPicker
+*
+* @tbrief Create the region's framebuffer and the ring's pixel buffers once, picks don't allocate anything.
+* @tparam windowWidth The width of the window in pixels, the cursor's coordinates are in the window.
+* @tparam windowHeight The height of the window in pixels.
+*/
+GPUPicker::GPUPicker(int windowWidth, int windowHeight)
+{
+	m_windowWidth = windowWidth;
+	m_windowHeight = windowHeight;
+	m_nextSlot = 0;
+	m_nextSerial = 0;
+	m_lastCollectedSerial = 0;
+
+	glGenRenderbuffers(1, &m_colorRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, GPU_PICKING_REGION_SIZE, GPU_PICKING_REGION_SIZE);
+	glGenRenderbuffers(1, &m_depthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, GPU_PICKING_REGION_SIZE, GPU_PICKING_REGION_SIZE);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorRenderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	for (int i = 0; i < GPU_PICKING_RING_SIZE; i++)
+	{
+		glGenBuffers(1, &m_ring[i].pixelBuffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_ring[i].pixelBuffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, 4 + sizeof(float), NULL, GL_STREAM_READ);
+		m_ring[i].fence = 0;
+		m_ring[i].serial = 0;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+/*
+* isSupported
+*
+* @tbrief Whether the context has what the picker uses: fences (GL 3.2 or ARB_sync), framebuffer objects and mapped
+* buffer ranges (GL 3.0 or their ARB extensions) and pixel buffer objects (GL 2.1 or ARB_pixel_buffer_object).
+*/
+bool GPUPicker::isSupported()
+{
+	return (GLEW_VERSION_3_2 || GLEW_ARB_sync) &&
+		(GLEW_VERSION_3_0 || (GLEW_ARB_framebuffer_object && GLEW_ARB_map_buffer_range)) &&
+		(GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object);
+}
+
+GPUPicker::~GPUPicker()
+{
+	for (int i = 0; i < GPU_PICKING_RING_SIZE; i++)
+	{
+		if (m_ring[i].fence)
+		{
+			glDeleteSync(m_ring[i].fence);
+		}
+		glDeleteBuffers(1, &m_ring[i].pixelBuffer);
+	}
+	glDeleteFramebuffers(1, &m_framebuffer);
+	glDeleteRenderbuffers(1, &m_colorRenderbuffer);
+	glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+}
+
+/*
+* beginPick
+*
+* @tbrief Bind the region's framebuffer and clear it to the background ID, the ID pass is drawn after this call.
+* @tparam xpos Cursor x position in the window.
+* @tparam ypos Cursor y position in the window, from the top.
+* @treturn The region's projection, applied after the scene's projection it maps the region around the cursor
+* over the whole framebuffer, with the cursor's pixel at the middle.
+*/
+mat4 GPUPicker::beginPick(float xpos, float ypos)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, GPU_PICKING_REGION_SIZE, GPU_PICKING_REGION_SIZE);
+	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// The region's middle is the cursor pixel's bottom left corner, in normalized device coordinates.
+	float centerX = 2.0f * (int)xpos / m_windowWidth - 1.0f;
+	float centerY = 2.0f * (m_windowHeight - 1 - (int)ypos) / m_windowHeight - 1.0f;
+	return scale(mat4(1.0f), vec3((float)m_windowWidth / GPU_PICKING_REGION_SIZE, (float)m_windowHeight / GPU_PICKING_REGION_SIZE, 1.0f)) *
+		translate(mat4(1.0f), vec3(-centerX, -centerY, 0.0f));
+}
+
+/*
+* endPick
+*
+* @tbrief Copy the cursor pixel's ID and depth into the next buffer of the ring and fence it, without waiting for the GPU.
+* Then bind the window's framebuffer back.
+*/
+void GPUPicker::endPick()
+{
+	// All the ring's readbacks are in flight, drop the oldest one.
+	Readback& readback = m_ring[m_nextSlot];
+	if (readback.fence)
+	{
+		glDeleteSync(readback.fence);
+	}
+
+	int pixel = GPU_PICKING_REGION_SIZE / 2;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer);
+	glReadPixels(pixel, pixel, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	glReadPixels(pixel, pixel, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, (void*)4);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	readback.serial = ++m_nextSerial;
+	m_nextSlot = (m_nextSlot + 1) % GPU_PICKING_RING_SIZE;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_windowWidth, m_windowHeight);
+}
+
+/*
+* pollResult
+*
+* @tbrief Collect the readbacks whose fences have signaled, never waits for the GPU.
+* @tparam id Set to the newest finished pick's ID, GPU_PICKING_BACKGROUND_ID if nothing was under the cursor.
+* @tparam depth Set to the newest finished pick's window depth, 1 (the far plane) for the background.
+* @treturn false if no pick finished since the last call.
+*/
+bool GPUPicker::pollResult(int& id, float& depth)
+{
+	bool isCollected = false;
+	for (int i = 0; i < GPU_PICKING_RING_SIZE; i++)
+	{
+		Readback& readback = m_ring[i];
+		if (!readback.fence)
+		{
+			continue;
+		}
+		GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		{
+			continue;
+		}
+		glDeleteSync(readback.fence);
+		readback.fence = 0;
+
+		// A finished pick older than one already collected is stale.
+		if (readback.serial < m_lastCollectedSerial)
+		{
+			continue;
+		}
+		m_lastCollectedSerial = readback.serial;
+		isCollected = true;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer);
+		const unsigned char* data = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 4 + sizeof(float), GL_MAP_READ_BIT);
+		if (data)
+		{
+			id = data[0] + data[1] * 256 + data[2] * 256 * 256;
+			depth = *(const float*)(data + 4);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+	return isCollected;
+}
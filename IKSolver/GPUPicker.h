@@ -0,0 +1,58 @@
+#pragma once
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include "glm\glm.hpp"
+
+using namespace glm;
+
+// The pixels around the cursor rendered by the ID pass, and the number of readbacks that can be in flight at once.
+static const int GPU_PICKING_REGION_SIZE = 8;
+static const int GPU_PICKING_RING_SIZE = 3;
+
+// The ID the ID pass clears to, nothing was drawn under the cursor.
+static const int GPU_PICKING_BACKGROUND_ID = 0x00ffffff;
+
+/*
+* GPUPicker
+*
+* Asynchronous color ID picking. The ID pass renders only a GPU_PICKING_REGION_SIZE square of pixels around the cursor,
+* into an offscreen framebuffer that is never shown, with a projection that stretches that region over the whole
+* framebuffer. The ID and the depth of the pixel under the cursor are copied into the next pixel buffer object of a ring
+* with a fence after them, so nothing waits for the GPU. The result is collected a frame or two later, once its fence
+* has signaled, and if more picks than the ring holds are in flight the oldest one is dropped. Fences need GL 3.2 or
+* ARB_sync, check isSupported before creating a picker.
+*/
+class GPUPicker
+{
+	public:
+		GPUPicker(int windowWidth, int windowHeight);
+		~GPUPicker();
+
+		static bool isSupported();
+
+		mat4 beginPick(float xpos, float ypos);
+		void endPick();
+		bool pollResult(int& id, float& depth);
+
+	private:
+		// A readback in flight, its buffer holds the pixel's RGBA ID followed by its float depth.
+		struct Readback
+		{
+			GLuint pixelBuffer;
+			GLsync fence;
+			int serial;
+		};
+
+		int m_windowWidth, m_windowHeight;
+
+		// The offscreen ID framebuffer, the size of the region.
+		GLuint m_framebuffer;
+		GLuint m_colorRenderbuffer;
+		GLuint m_depthRenderbuffer;
+
+		Readback m_ring[GPU_PICKING_RING_SIZE];
+		int m_nextSlot;
+		int m_nextSerial;
+		int m_lastCollectedSerial;
+};
@@ -1,11 +1,16 @@
 #include "IKSolver.h"
 
-IKSolver::IKSolver()
+IKSolver::IKSolver(int numOfLinks)
 {
 	m_pressedIndex = -1;
+	m_pressedDepth = 1.0f;
+	m_numOfLinks = numOfLinks;
+	m_targetCubeIndex = numOfLinks;
 
 	m_shader = new Shader("./res/shaders/basicShader");
 	m_pickingShader = new Shader("./res/shaders/pickingShader");
+	m_uniforms = new UniformBuffers();
+	m_renderQueue = new RenderQueue(RENDER_QUEUE_CAPACITY);
 
 	// Initialize the scene parameters.
 	m_scene = new SceneData(vec3(0, 5, -45), Z_AXIS, Y_AXIS);
@@ -16,44 +21,49 @@ IKSolver::IKSolver()
 	// Initialize the rest of the member parameters.
 	m_link = new Cube(vec3(0), LINK_SIZE);
 	m_target = new Cube(vec3(0), TARGET_SIZE, vec3(1, 0.5, 1));
-	m_linkBottomPoint = translate(vec3(0, 0, -LINK_SIZE.z / 2));
-	m_linkTopPoint = translate(vec3(0, 0, LINK_SIZE.z / 2));
+	m_axisMesh = createAxisMesh();
 
-	m_lastReachedTargetPoint = vec4(INFINITY);
+	m_lastReachedTargetPoint = vec3(INFINITY);
 	m_isTargetOutOfReach = false;
-	m_angleSizeFactor = 25;
 	m_isStopped = true;
 
 	// Rotate the scene's projection 90 degrees around the x axis.
 	m_scene->setProjection(rotate(m_scene->getProjection(), -90.0f, X_AXIS));
 
-	// Initialize cube transformation matrices.
-	for (int i = 0; i < NUM_OF_CUBES; ++i) 
-	{
-		// Rotations not enabled on the target, only on the chain.
-		if (i < NUM_OF_LINKS)
-		{
-			m_cubeRotations[i] = mat4(1.0);
+	// Initialize the chain with the base link's middle at the origin, the chain's end is the corner of the last link's top.
+	m_chain = new IKChain(m_numOfLinks, vec3(0, 0, -LINK_SIZE.z / 2), LINK_SIZE.z);
+	m_chain->setEndEffectorOffset(vec3(1, 1, 0));
+	m_chain->setStretchEnabled(true);
+	m_poseCache = new IKPoseCache(POSE_CACHE_CAPACITY, m_numOfLinks, POSE_CACHE_CELL_SIZE);
 
-			// ZXZ Euler Angles as three successive rotations around z, x, and z axes.
-			// ZXZ Euler Angles are also known as proper Euler Angles.
-			m_rotateX[i] = mat4(1.0);
-			m_rotateZ[i] = mat4(1.0);
-			m_rotateZ2[i] = mat4(1.0);
-		}
-		m_cubeTranslations[i] = mat4(1.0);
-		m_cubeTransformations[i] = mat4(1.0);
+	// Use the chain's reachability map if one was built for it, otherwise the solver falls back to the reach sphere.
+	m_reachabilityMap = new IKReachabilityMap();
+	std::string reachabilityMapPath = REACHABILITY_MAP_PATH_PREFIX + std::to_string(m_numOfLinks) + REACHABILITY_MAP_PATH_SUFFIX;
+	if (m_reachabilityMap->open(reachabilityMapPath.c_str()) && !m_reachabilityMap->matches(*m_chain))
+	{
+		std::cout << reachabilityMapPath << " was built for a different chain" << std::endl;
+		m_reachabilityMap->close();
+	}
 
-		// Set the starting position of every link.
-		if (i > BASE_LINK_INDEX && i < NUM_OF_LINKS)
-		{
-			m_cubeTranslations[i] = translate(m_cubeTranslations[i], vec3(0.0f, 0.0f, LINK_SIZE.z * 1.0f));
-		}
-		else if (i == TARGET_CUBE_INDEX)
-		{
-			m_cubeTranslations[i] = translate(m_cubeTranslations[i], TARGET_START_POSITION);
-		}
+	// Every link and the target is a pickable box.
+	m_pickingBVH = new PickingBVH(m_targetCubeIndex + 1);
+	m_pickingTransformations.resize(m_targetCubeIndex + 1);
+	m_pickingSizes.assign(m_numOfLinks, LINK_SIZE);
+	m_pickingSizes.push_back(TARGET_SIZE);
+	// Without fences and pixel buffers there's no GPU picking, the ray cast is always used.
+	m_gpuPicker = GPUPicker::isSupported() ? new GPUPicker(DISPLAY_WIDTH, DISPLAY_HEIGHT) : NULL;
+	m_isGPUPicking = false;
+
+	// Rotations not enabled on the target, only on the chain.
+	m_targetTranslation = translate(TARGET_START_POSITION);
+	updateTransformations();
+
+	// The picking hierarchy is built once for the starting pose, every ray pick refits it to the current pose.
+	for (int i = 0; i <= m_targetCubeIndex; i++)
+	{
+		m_pickingTransformations[i] = getCubeTransformation(i);
 	}
+	m_pickingBVH->build(&m_pickingTransformations[0], &m_pickingSizes[0], m_targetCubeIndex + 1);
 
 	// Initialize 2 textures, 1 for the chain and 1 for the target.
 	// Before drawing a cube, bind its matching texture id.
@@ -64,96 +74,160 @@ IKSolver::IKSolver()
 /*
 * drawLinksAxisSystem
 * 
-* @tbrief Draws the axis of every box in the chain.
+* @tbrief Queue the axis lines of every box in the chain, an instance of the axis mesh placed by every link's own object,
+* drawn by the queue with the same objects as the links.
 */
 void IKSolver::drawLinksAxisSystem()
 {	
-	// X axis line at the bottom of the link.
-	glBegin(GL_LINES);
-	glVertex3f(-10.0f, 0.0f, -LINK_SIZE.z / 2);
-	glVertex3f(10.0f, 0.0f, -LINK_SIZE.z / 2);
-
-	// Y Axis line at the bottom of the link.
-	glBegin(GL_LINES);
-	glVertex3f(0.0f, 10.0f, -LINK_SIZE.z / 2);
-	glVertex3f(0.0f, -10.0f, -LINK_SIZE.z / 2);
-
-	// Z axis line.
-	glBegin(GL_LINES);
-	glVertex3f(0.0f, 0.0f, 10.0f);
-	glVertex3f(0.0f, 0.0f, -10.0f);
-	glEnd();
+	m_renderQueue->Add(m_shader, m_chainTextureId, m_axisMesh, m_linksObject, m_numOfLinks);
 }
 
-void IKSolver::spacePressed()
+/*
+* createAxisMesh
+*
+* @tbrief The black axis lines in a link's local coordinates, x and y at the bottom of the link and the z axis through its middle.
+*/
+Mesh* IKSolver::createAxisMesh()
 {
-	m_isStopped = !m_isStopped;
-	if (!m_isStopped)
+	static const vec3 axisPoints[] =
+	{
+		vec3(-10.0f, 0.0f, -LINK_SIZE.z / 2), vec3(10.0f, 0.0f, -LINK_SIZE.z / 2),
+		vec3(0.0f, 10.0f, -LINK_SIZE.z / 2), vec3(0.0f, -10.0f, -LINK_SIZE.z / 2),
+		vec3(0.0f, 0.0f, 10.0f), vec3(0.0f, 0.0f, -10.0f)
+	};
+	static const int numOfAxisPoints = sizeof(axisPoints) / sizeof(axisPoints[0]);
+
+	std::vector<Vertex> vertices;
+	unsigned int indices[numOfAxisPoints];
+	for (int i = 0; i < numOfAxisPoints; i++)
 	{
-		runCCDSolverAlgorithm();
+		vertices.push_back(Vertex(axisPoints[i], vec2(0), vec3(0), vec3(0)));
+		indices[i] = i;
 	}
+	return new Mesh(&vertices[0], numOfAxisPoints, indices, numOfAxisPoints, MESH_LINES);
+}
+
+void IKSolver::spacePressed()
+{
+	m_isStopped = !m_isStopped;
 }
 
 /*
-* runCCDSolverAlgorithm
+* toggleSolverType
 *
-* @tbrief IK solver by the CCD algorithm.
+* @tbrief Switch the chain to the next solver, CCD -> FABRIK -> Jacobian transpose -> Jacobian DLS -> Jacobi CCD -> CCD.
 */
-void IKSolver::runCCDSolverAlgorithm()
-{		
-	float threshold = 0.1f;
-	float chainMaxLength = LINK_SIZE.z * NUM_OF_LINKS;
+void IKSolver::toggleSolverType()
+{
+	static const char* solverNames[] = { "CCD", "FABRIK", "Jacobian transpose", "Jacobian DLS", "Jacobi CCD" };
+	int solverType = (m_chain->getSolverType() + 1) % (sizeof(solverNames) / sizeof(solverNames[0]));
+	m_chain->setSolverType((IKSolverType)solverType);
+	std::cout << "solver: " << solverNames[solverType] << std::endl;
+}
 
-	// Top of the last part in the chain, every link's position represents it's middle so we raise it have its length to get to it's top point.
-	vec4 chainTopPoint = m_cubeTransformations[NUM_OF_LINKS - 1] * m_linkTopPoint * vec4(1, 1, 0, 1);
+/*
+* getCubeTransformation
+*
+* @tbrief The world transformation of a cube in the scene, chain index = 0 .. m_numOfLinks - 1, target = m_targetCubeIndex.
+*/
+mat4 IKSolver::getCubeTransformation(int index)
+{
+	return (index == m_targetCubeIndex) ? m_targetTransformation : m_chain->getLinkTransformation(index);
+}
 
-	// Bottom of the base part in the chain.
-	vec4 chainBottomPoint = m_cubeTransformations[0] * m_linkBottomPoint * vec4(1);
+/*
+* getTargetPoint
+*
+* @tbrief Destination = target tranformations + offset on the target.
+*/
+vec3 IKSolver::getTargetPoint()
+{
+	return vec3(m_targetTransformation * translate(vec3(-2, 0, -1)) * vec4(1));
+}
+
+/*
+* updateTransformations
+*
+* @tbrief Calculate the world transformations of all the chain links and the target.
+*/
+void IKSolver::updateTransformations()
+{
+	m_chain->updateTransformations();
+	m_targetTransformation = m_targetTranslation;
+}
 
-	// Destination = target tranformations + offset on the target.
-	vec4 targetPoint = m_cubeTransformations[TARGET_CUBE_INDEX] * translate(vec3(-2, 0, -1)) * vec4(1);
-	
-	// Target too far.
-	if (distance(targetPoint, chainBottomPoint) > chainMaxLength)
+/*
+* updateUniforms
+*
+* @tbrief Fill the frame's constants and every object's model matrix and picking ID, and upload them in one go.
+* @tparam viewProjection The projection every object is drawn with.
+*/
+void IKSolver::updateUniforms(mat4 viewProjection)
+{
+	m_uniforms->SetFrame(viewProjection, LIGHT_DIRECTION, LIGHT_COLOR);
+	m_uniforms->ClearObjects();
+	m_linksObject = m_uniforms->AddObjects(m_chain->getLinkTransformations(), m_numOfLinks, 0);
+	m_targetObject = m_uniforms->AddObjects(&m_targetTransformation, 1, m_targetCubeIndex);
+	m_uniforms->Upload();
+}
+
+/*
+* solve
+*
+* @tbrief Solve the chain to the target's current position until the deadline, see IKChain::solveUntil.
+* With a reachability map unreachable targets are rejected by a lookup, and far targets are seeded from the map,
+* then the pose cache may seed the chain with a nearer pose.
+* @tparam deadline The time by which the solve returns, with the best pose it found.
+* @tparam tolerance Distance from the target at which the target counts as reached.
+* @treturn The number of sweeps run, the remaining distance from the target and whether the target is in the chain's reach.
+*/
+IKSolveResult IKSolver::solve(IKClock::time_point deadline, float tolerance)
+{
+	updateTransformations();
+	vec3 targetPoint = getTargetPoint();
+	if (m_reachabilityMap->isOpen())
 	{
-		// Only print "cannot reach" when changing status from can reach to can't reach.
-		if (!m_isTargetOutOfReach)
+		if (!m_reachabilityMap->isReachable(m_chain->getBasePosition(), targetPoint))
 		{
-			std::cout << "cannot reach" << std::endl;
-			m_isTargetOutOfReach = true;
+			return m_chain->stretchTowards(targetPoint);
 		}
-	}
-	// Target reached.
-	else if (distance(targetPoint, chainTopPoint) <= threshold)
-	{
-		bool targetPointChanged = (distance(m_lastReachedTargetPoint, targetPoint) > threshold);
-		if (targetPointChanged)
+		if (distance(targetPoint, m_chain->getEndEffectorPoint()) > tolerance)
 		{
-			m_lastReachedTargetPoint = targetPoint;
-			std::cout << distance(targetPoint, chainTopPoint) << std::endl;
+			m_reachabilityMap->warmStart(*m_chain, targetPoint);
 		}
 	}
-	// Move closer to the target.
-	else
-	{
-		// std::cout << "targetPoint = (" << targetPoint.x << ", " << targetPoint.y << ", " << targetPoint.z << ", " << targetPoint.w << ")" << std::endl;
-		// std::cout << "chainTopPoint = (" << chainTopPoint.x << ", " << chainTopPoint.y << ", " << chainTopPoint.z << ", " << chainTopPoint.w << ")" << std::endl;
+	return m_poseCache->solveUntil(*m_chain, targetPoint, deadline, tolerance);
+}
 
-		m_isTargetOutOfReach = false;
+/*
+* solveToTarget
+*
+* @tbrief Solve the chain to the target's current position within the frame's IK budget and report status changes,
+* a target that wasn't reached this frame is solved further from the best pose in the next frames.
+*/
+void IKSolver::solveToTarget()
+{
+	IKSolveResult result = solve(IKClock::now() + std::chrono::microseconds(SOLVE_BUDGET_MICROSECONDS), SOLVE_TOLERANCE);
 
-		// For every part in the chain rotate it a bit according to the algorithm.
-		for (int i = (NUM_OF_LINKS - 1); i >= BASE_LINK_INDEX; i--) 
+	if (!result.isReachable)
+	{
+		// Only print "cannot reach" when changing status from can reach to can't reach, the chain points at the target.
+		if (!m_isTargetOutOfReach)
 		{
-			// r = link root, e = chain end, d = desired endpoint, re = vector from r to e, rd = vector from r to d.
-			vec4 r = m_cubeTransformations[i] * m_linkBottomPoint * vec4(1);
-			vec4 re = normalize(chainTopPoint - r);
-			vec4 rd = normalize(targetPoint - r);
-
-			// rotate the current link around the (re X rd) posture vector  by the angle between re and rd and the angle size factor.
-			m_cubeRotations[i] = m_linkBottomPoint * rotate(degrees(acos(clamp(dot(re, rd), -1.0f, 1.0f))) / m_angleSizeFactor, normalize(cross((vec3)re, (vec3)rd))) * m_linkTopPoint * m_cubeRotations[i];
-
-			chainTopPoint = m_cubeTransformations[NUM_OF_LINKS - 1] * m_linkTopPoint * vec4(1, 1, 0, 1);
+			std::cout << "cannot reach, gap: " << result.residual << std::endl;
+			m_isTargetOutOfReach = true;
 		}
+		return;
+	}
+	m_isTargetOutOfReach = false;
+
+	// Target reached, print it's distance once per target position.
+	vec3 targetPoint = getTargetPoint();
+	bool targetPointChanged = (distance(m_lastReachedTargetPoint, targetPoint) > SOLVE_TOLERANCE);
+	if (result.residual <= SOLVE_TOLERANCE && targetPointChanged)
+	{
+		m_lastReachedTargetPoint = targetPoint;
+		std::cout << result.residual << " (" << result.iterations << " iterations)" << std::endl;
 	}
 }
 
@@ -169,19 +243,21 @@ void IKSolver::handleArrowRotation(int axis, int dir)
 	float rotationSpeed = 3;
 
 	// Pressed a link in the chain,  rotate that link and that will rotateall the links above it.
-	if (m_pressedIndex >= BASE_LINK_INDEX && m_pressedIndex < NUM_OF_LINKS)
+	if (m_pressedIndex >= BASE_LINK_INDEX && m_pressedIndex < m_numOfLinks)
 	{
 		// Pressed top / bottom arrow, rotate aroud the x axis.
 		if (axis)
 		{
-			m_rotateX[m_pressedIndex] = m_linkBottomPoint * rotate(dir * rotationSpeed, X_AXIS) * m_linkTopPoint * m_rotateX[m_pressedIndex];
+			m_chain->rotateLinkX(m_pressedIndex, dir * rotationSpeed);
 		}
 		// Pressed left / right arrow, rotate aroud the z axis.
 		else
 		{
-			m_rotateZ[m_pressedIndex] = m_linkBottomPoint * rotate(dir * rotationSpeed, Z_AXIS) * m_linkTopPoint * m_rotateZ[m_pressedIndex];
-			m_rotateZ2[m_pressedIndex] = m_linkBottomPoint * rotate(dir * rotationSpeed, -Z_AXIS) * m_linkTopPoint * m_rotateZ2[m_pressedIndex];
+			m_chain->rotateLinkZ(m_pressedIndex, dir * rotationSpeed);
 		}
+
+		// The cached poses don't include the user's rotations.
+		m_poseCache->clear();
 	}
 	// Not pressed a link in the chain, rotate the scene.
 	else if (m_pressedIndex == -1)
@@ -210,11 +286,11 @@ void IKSolver::handleLeftMouseDragging(float curX, float prevX, float curY, floa
 {
 	float angle = 0.5;
 
-	if (m_pressedIndex >= BASE_LINK_INDEX && m_pressedIndex < NUM_OF_LINKS)
+	if (m_pressedIndex >= BASE_LINK_INDEX && m_pressedIndex < m_numOfLinks)
 	{
-		m_rotateX[m_pressedIndex] = m_linkBottomPoint * rotate((float)(curY - prevY) * angle, X_AXIS) * m_linkTopPoint * m_rotateX[m_pressedIndex];
-		m_rotateZ[m_pressedIndex] = m_linkBottomPoint * rotate((float)(curX - prevX) * angle, Z_AXIS) * m_linkTopPoint * m_rotateZ[m_pressedIndex];
-		m_rotateZ2[m_pressedIndex] = m_linkBottomPoint * rotate((float)(curX - prevX) * angle, -Z_AXIS) * m_linkTopPoint * m_rotateZ2[m_pressedIndex];
+		m_chain->rotateLinkX(m_pressedIndex, (float)(curY - prevY) * angle);
+		m_chain->rotateLinkZ(m_pressedIndex, (float)(curX - prevX) * angle);
+		m_poseCache->clear();
 	}
 	else if (m_pressedIndex == -1)
 	{
@@ -232,18 +308,18 @@ void IKSolver::handleLeftMouseDragging(float curX, float prevX, float curY, floa
 */
 void IKSolver::handleRightMouseDragging(float transX, float transY)
 {
-	if (m_pressedIndex >= BASE_LINK_INDEX && m_pressedIndex < NUM_OF_LINKS)
+	if (m_pressedIndex >= BASE_LINK_INDEX && m_pressedIndex < m_numOfLinks)
 	{
-		m_cubeTranslations[BASE_LINK_INDEX] = translate(vec3(transX, 0, transY)) * m_cubeTranslations[BASE_LINK_INDEX];
+		m_chain->translateBase(vec3(transX, 0, transY));
 	}
-	else if (m_pressedIndex == TARGET_CUBE_INDEX)
+	else if (m_pressedIndex == m_targetCubeIndex)
 	{
-		m_cubeTranslations[TARGET_CUBE_INDEX] = translate(vec3(transX, 0, transY)) * m_cubeTranslations[TARGET_CUBE_INDEX];
+		m_targetTranslation = translate(vec3(transX, 0, transY)) * m_targetTranslation;
 	}
 	else
 	{
-		m_cubeTranslations[BASE_LINK_INDEX] = translate(vec3(transX, 0, transY)) * m_cubeTranslations[BASE_LINK_INDEX];
-		m_cubeTranslations[TARGET_CUBE_INDEX] = translate(vec3(transX, 0, transY)) * m_cubeTranslations[TARGET_CUBE_INDEX];
+		m_chain->translateBase(vec3(transX, 0, transY));
+		m_targetTranslation = translate(vec3(transX, 0, transY)) * m_targetTranslation;
 	}
 }
 
@@ -258,112 +334,166 @@ void IKSolver::handleScrollCallback(float offsetY)
 	// If offsetY >= 0 we're scrolling up so scroll backwards, otherwise scroll forwards.  
 	int direction = offsetY >= 0 ? -1 : 1;
 
-	if (m_pressedIndex >= BASE_LINK_INDEX && m_pressedIndex < NUM_OF_LINKS)
+	if (m_pressedIndex >= BASE_LINK_INDEX && m_pressedIndex < m_numOfLinks)
 	{
-		m_cubeTranslations[BASE_LINK_INDEX] = m_cubeTranslations[BASE_LINK_INDEX] * translate(vec3(0, direction, 0));
+		m_chain->translateBase(vec3(0, direction, 0));
 	}
-	else if (m_pressedIndex == TARGET_CUBE_INDEX)
+	else if (m_pressedIndex == m_targetCubeIndex)
 	{
-		m_cubeTranslations[TARGET_CUBE_INDEX] = m_cubeTranslations[TARGET_CUBE_INDEX] * translate(vec3(0, direction, 0));
+		m_targetTranslation = m_targetTranslation * translate(vec3(0, direction, 0));
 	}
 }
 
 /*
 * handleMouseCallback
 *
-* @tbrief Mouse press, calculate the pressed index with a picking shader, scene index = -1, chain index = 0 .. NUM_OF_LINKS, target = TARGET_CUBE_INDEX.
+* @tbrief Mouse press, pick the pressed cube, scene index = -1, chain index = 0 .. m_numOfLinks - 1, target = m_targetCubeIndex.
+* A ray pick is done at once, a GPU pick is collected a frame or two later and the selection doesn't change until then.
 * @tparam xpos Mouse pressed x position.
 * @tparam ypos Mouse pressed y position.
 */
 void IKSolver::handleMouseCallback(float xpos, float ypos)
 {
-	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	m_pickingShader->Bind();
+	if (m_isGPUPicking)
+	{
+		pickWithGPU(xpos, ypos);
+	}
+	else
+	{
+		pickWithRay(xpos, ypos);
+	}
+}
 
-	for (int i = 0; i < NUM_OF_CUBES; i++)
+/*
+* togglePickingMode
+*
+* @tbrief Switch between ray picking on the CPU and the asynchronous ID pass on the GPU, if the GPU supports it.
+*/
+void IKSolver::togglePickingMode()
+{
+	if (!m_gpuPicker)
 	{
-		m_scene->setMainMat(m_cubeTransformations[i]);
-		m_scene->muliplyMVP();
+		std::cout << "picking: CPU ray cast, GPU picking needs GL 3.2 or ARB_sync" << std::endl;
+		return;
+	}
+	m_isGPUPicking = !m_isGPUPicking;
+	std::cout << "picking: " << (m_isGPUPicking ? "GPU ID pass" : "CPU ray cast") << std::endl;
+}
 
-		// The index we passed is translated to an rgb color in the shader.
-		m_pickingShader->Update(mat4(m_scene->getMVP()), mat4(m_scene->getMainMat()), i);
+/*
+* getPressedDepth
+*
+* @tbrief The window depth of the pressed point, as it would be read from the depth buffer, 1 (the far plane) for the background.
+*/
+float IKSolver::getPressedDepth()
+{
+	return m_pressedDepth;
+}
 
-		if (i < NUM_OF_LINKS)
-		{
-			m_link->draw();
-		}
-		else if (i == TARGET_CUBE_INDEX)
-		{
-			m_target->draw();
-		}
-	}	
-	unsigned char data[4];
-	glReadPixels(xpos, DISPLAY_HEIGHT - ypos - 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+/*
+* pickWithRay
+*
+* @tbrief Cast a ray from the camera through the cursor against the boxes of the scene's cubes on the CPU, the nearest cube hit is pressed.
+* The boxes are refitted to the cubes' current transformations first, the hierarchy itself was built with the scene.
+*/
+void IKSolver::pickWithRay(float xpos, float ypos)
+{
+	updateTransformations();
+	for (int i = 0; i <= m_targetCubeIndex; i++)
+	{
+		m_pickingTransformations[i] = getCubeTransformation(i);
+	}
+	m_pickingBVH->refit(&m_pickingTransformations[0]);
+
+	// The cursor's pixel center on the near and far planes, back from clip coordinates to the world.
+	mat4 projection = m_scene->getProjection();
+	mat4 inverseProjection = inverse(projection);
+	float ndcX = 2.0f * (xpos + 0.5f) / DISPLAY_WIDTH - 1.0f;
+	float ndcY = 1.0f - 2.0f * (ypos + 0.5f) / DISPLAY_HEIGHT;
+	vec4 nearPoint = inverseProjection * vec4(ndcX, ndcY, -1.0f, 1.0f);
+	vec4 farPoint = inverseProjection * vec4(ndcX, ndcY, 1.0f, 1.0f);
+	vec3 rayOrigin = vec3(nearPoint) / nearPoint.w;
+	vec3 rayDirection = vec3(farPoint) / farPoint.w - rayOrigin;
+
+	float hitDistance;
+	m_pressedIndex = m_pickingBVH->raycast(rayOrigin, rayDirection, hitDistance);
+	if (m_pressedIndex == -1)
+	{
+		m_pressedDepth = 1.0f;
+		return;
+	}
 
-	// Convert back from rgb color to the index we passed.
-	int pickedID = data[0] + data[1] * 256 + data[2] * 256 * 256;
+	// The hit point's depth, from normalized device coordinates to the window's [0, 1] depth range.
+	vec4 hitPoint = projection * vec4(rayOrigin + hitDistance * rayDirection, 1.0f);
+	m_pressedDepth = (hitPoint.z / hitPoint.w) * 0.5f + 0.5f;
+}
 
-	// Full white, must be the background.
-	if (pickedID == 0x00ffffff)
-	{ 
-		m_pressedIndex = -1;
-	}
-	else 
+/*
+* pickWithGPU
+*
+* @tbrief Draw every cube with its index as its color into the picker's region around the cursor, offscreen,
+* and queue the readback of the cursor's pixel. Nothing waits for the GPU, see collectGPUPick.
+*/
+void IKSolver::pickWithGPU(float xpos, float ypos)
+{
+	updateTransformations();
+	mat4 regionProjection = m_gpuPicker->beginPick(xpos, ypos);
+
+	// Every object's index is translated to an rgb color in the shader, from its uniforms.
+	updateUniforms(regionProjection * m_scene->getProjection());
+	m_link->draw(m_renderQueue, m_pickingShader, 0, m_linksObject, m_numOfLinks);
+	m_target->draw(m_renderQueue, m_pickingShader, 0, m_targetObject, 1);
+	m_renderQueue->Execute(m_uniforms);
+	m_gpuPicker->endPick();
+}
+
+/*
+* collectGPUPick
+*
+* @tbrief Apply the newest GPU pick whose readback finished, the pressed index and depth come from the same pixel.
+*/
+void IKSolver::collectGPUPick()
+{
+	int pickedID;
+	float depth;
+	if (!m_gpuPicker || !m_gpuPicker->pollResult(pickedID, depth))
 	{
-		m_pressedIndex = pickedID;
+		return;
 	}
+
+	// Cleared to full white, must be the background.
+	m_pressedIndex = (pickedID == GPU_PICKING_BACKGROUND_ID) ? -1 : pickedID;
+	m_pressedDepth = depth;
 }
 
 /*
 * draw
 *
 * @tbrief Called every game loop's draw iteration, render the scene to the window.
+* The chain and its axis lines are drawn with an instanced draw call each for every UNIFORM_OBJECTS_PER_DRAW links, and the target with another.
 */
 void IKSolver::draw()
 {
-	// Iterate all the chain links and the target.
-	for (int i = 0; i < NUM_OF_CUBES; i++)
-	{
-		if (i == BASE_LINK_INDEX)
-		{
-			m_cubeTransformations[i] = m_cubeTranslations[i] * m_cubeRotations[i] * m_rotateZ2[i] * m_rotateX[i] * m_rotateZ[i];
-			// Bind the m_chainTextureId texture of the chain, we only do this for the base link because the shader only changes after the last link, for the target.
-			m_shader->bindTexture(m_chainTextureId);
-		}
-		else if (i < NUM_OF_LINKS)
-		{	
-			// Calculate transformations according to the previous link.
-			m_cubeTransformations[i] = m_cubeTransformations[i - 1] * m_cubeTranslations[i] * m_cubeRotations[i] * m_rotateZ2[i] * m_rotateX[i] * m_rotateZ[i];
-		}
-		else if (i == TARGET_CUBE_INDEX)
-		{			
-			// Set the target's tranformtions and bind it's shader.
-			m_cubeTransformations[i] = m_cubeTranslations[i];
-			m_shader->bindTexture(m_targetTextureId);
-		}
-		 
-		// Set the scene's MVP according to the current object's transformations.
-		m_scene->setMainMat(m_cubeTransformations[i]);
-		m_scene->muliplyMVP();
-		m_shader->Bind();
-		m_shader->Update(m_scene->getMVP(), m_scene->getMainMat());
-
-		// Draw the current object.
-		if (i < NUM_OF_LINKS)
-		{
-			m_link->draw();
-			drawLinksAxisSystem();
-		}
-		else if (i == TARGET_CUBE_INDEX)
-		{
-			m_target->draw();
-		}
-	}
+	// A GPU pick from an earlier frame may be ready by now.
+	collectGPUPick();
+
+	// Solve before drawing so the display shows the converged pose.
 	if (!m_isStopped)
 	{
-		runCCDSolverAlgorithm();
+		solveToTarget();
 	}
+
+	// Calculate the transformations of all the chain links and the target.
+	updateTransformations();
+
+	// Upload the frame's uniforms once, every object's model matrix is then read by its instance.
+	updateUniforms(m_scene->getProjection());
+
+	// Queue all the links of the chain and their axis lines with the chain's texture, and the target with it's own texture.
+	m_link->draw(m_renderQueue, m_shader, m_chainTextureId, m_linksObject, m_numOfLinks);
+	m_target->draw(m_renderQueue, m_shader, m_targetTextureId, m_targetObject, 1);
+	drawLinksAxisSystem();
+	m_renderQueue->Execute(m_uniforms);
 }
 
 IKSolver::~IKSolver()
@@ -371,4 +501,17 @@ IKSolver::~IKSolver()
 	// Delete texture objects.
 	glDeleteTextures(1, &m_chainTextureId);
 	glDeleteTextures(1, &m_targetTextureId);
+
+	// Delete the cubes and their GPU buffers.
+	delete m_link;
+	delete m_target;
+	delete m_axisMesh;
+	delete m_gpuPicker;
+	delete m_pickingBVH;
+	delete m_pickingShader;
+	delete m_renderQueue;
+	delete m_uniforms;
+	delete m_reachabilityMap;
+	delete m_poseCache;
+	delete m_chain;
 }
@@ -3,8 +3,15 @@
 #include "Config.h"
 #include <iostream>
 #include "glm\glm.hpp"
+#include <IKChain.h>
+#include <IKPoseCache.h>
+#include <IKReachabilityMap.h>
+#include <string>
 #include <Cube.h>
 #include <SceneData.h>
+#include <PickingBVH.h>
+#include <GPUPicker.h>
+#include <vector>
 #include "shader.h"
 #include "display.h"
 #include <GLFW/glfw3.h>
@@ -16,15 +23,33 @@
 #define Z_AXIS vec3(0, 0, 1.0f)
 
 // IK Solver parameters, the chain starts from index 0 till before last cube that is the target.
-static const int NUM_OF_CUBES = 7;
-static const int NUM_OF_LINKS = NUM_OF_CUBES - 1;
-static const int TARGET_CUBE_INDEX = NUM_OF_CUBES - 1;
-static const int BASE_LINK_INDEX = 0;
+// The number of links is chosen at runtime, the target's index is the number of links.
+static const int DEFAULT_NUM_OF_LINKS = 6;
+static const int BASE_LINK_INDEX = IK_BASE_LINK_INDEX;
 
 static const vec3 LINK_SIZE = vec3(2.0f, 2.0f, 4.0f);
 static const vec3 TARGET_SIZE = vec3(2.0f, 2.0f, 2.0f);
 static const vec3 TARGET_START_POSITION = vec3(5.0f, 0.0f, 0.0f);
 
+// The number of draws a frame queues, the chain's, its axis lines' and the target's.
+static const int RENDER_QUEUE_CAPACITY = 3;
+
+// The scene's light, constant for every frame.
+static const vec3 LIGHT_DIRECTION = vec3(0.0f, 0.0f, 1.0f);
+static const vec3 LIGHT_COLOR = vec3(1.0f, 1.0f, 1.0f);
+
+// Solve parameters, the part of every frame the solve may take and the distance at which the target counts as reached.
+static const int SOLVE_BUDGET_MICROSECONDS = 2000;
+static const float SOLVE_TOLERANCE = 0.1f;
+
+// Pose cache parameters, the number of converged poses kept and the size of the cells targets are quantized into.
+static const int POSE_CACHE_CAPACITY = 64;
+static const float POSE_CACHE_CELL_SIZE = 0.5f;
+
+// Optional reachability map of the chain, built offline by IKBenchmark --build-reachability, followed by the number of links.
+static const std::string REACHABILITY_MAP_PATH_PREFIX = "./res/reachability/chain";
+static const std::string REACHABILITY_MAP_PATH_SUFFIX = ".ikmap";
+
 //Scene parameters
 static const float fovy = 60.0;
 static const float zNear = 0.1;
@@ -36,43 +61,71 @@ using namespace Config;
 class IKSolver
 {
 	public:
-		IKSolver();
+		IKSolver(int numOfLinks = DEFAULT_NUM_OF_LINKS);
 		void handleArrowRotation(int axis, int dir);
 		void handleLeftMouseDragging(float curX, float prevX, float curY, float prevY);
 		void handleRightMouseDragging(float transX, float transY);
 		void handleMouseCallback(float xpos, float ypos);
 		void handleScrollCallback(float yoffset);
 		void spacePressed();
+		void toggleSolverType();
+		void togglePickingMode();
+		float getPressedDepth();
 		void draw();
+		IKSolveResult solve(IKClock::time_point deadline, float tolerance);
 
 		~IKSolver();
 	private:
-		void runCCDSolverAlgorithm();
+		void solveToTarget();
+		void pickWithRay(float xpos, float ypos);
+		void pickWithGPU(float xpos, float ypos);
+		void collectGPUPick();
+		void updateTransformations();
+		void updateUniforms(mat4 viewProjection);
 		void drawLinksAxisSystem();
+		Mesh* createAxisMesh();
+		mat4 getCubeTransformation(int index);
+		vec3 getTargetPoint();
 
-		mat4 m_cubeTranslations[NUM_OF_CUBES];
-		mat4 m_cubeTransformations[NUM_OF_CUBES];
-		mat4 m_cubeRotations[NUM_OF_LINKS];
-
-		mat4 m_rotateX[NUM_OF_LINKS];
-		mat4 m_rotateZ[NUM_OF_LINKS];
-		mat4 m_rotateZ2[NUM_OF_LINKS];
-
-		mat4 m_linkBottomPoint, m_linkTopPoint;
+		// The chain's links and solver, the target is owned by the scene.
+		IKChain* m_chain;
+		IKPoseCache* m_poseCache;
+		IKReachabilityMap* m_reachabilityMap;
+		int m_numOfLinks;
+		int m_targetCubeIndex;
+		mat4 m_targetTranslation;
+		mat4 m_targetTransformation;
 
 		Cube* m_link;
 		Cube* m_target;
+		Mesh* m_axisMesh;
 		Shader* m_shader;
 		Shader* m_pickingShader;
 		SceneData* m_scene;
 
+		// Every object's uniforms, uploaded once per frame, and where the links and the target start.
+		UniformBuffers* m_uniforms;
+		unsigned int m_linksObject;
+		unsigned int m_targetObject;
+
+		// The frame's draws, sorted by program, texture and mesh before they're issued.
+		RenderQueue* m_renderQueue;
+
+		// Ray picking, the boxes of all the cubes in the scene, indexed like getCubeTransformation, or asynchronous
+		// GPU picking with an ID pass (no picker when the GPU lacks fences), and the window depth of the pressed point.
+		bool m_isGPUPicking;
+		PickingBVH* m_pickingBVH;
+		std::vector<mat4> m_pickingTransformations;
+		std::vector<vec3> m_pickingSizes;
+		GPUPicker* m_gpuPicker;
+		float m_pressedDepth;
+
 		unsigned int m_chainTextureId;
 		unsigned int m_targetTextureId;
 
 		bool m_isStopped;
 		bool m_isTargetOutOfReach;
-		vec4 m_lastReachedTargetPoint;
-		int m_angleSizeFactor;
+		vec3 m_lastReachedTargetPoint;
 		int m_pressedIndex;
 };
 
@@ -68,7 +68,7 @@ void InputHandler::cursorDraggingCallback(GLFWwindow* window, float xpos, float
 	if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT)) 
 	{
 		// Convert from window coordinates to camera coordinates.
-		float z = zFar + m_depth * (zNear - zFar);
+		float z = zFar + m_IKSolver->getPressedDepth() * (zNear - zFar);
 		float m_transX = (float)(ASPECT_RATIO * xrel / (float)(DISPLAY_HEIGHT)* zNear * 2.0 * tan(fovy * M_PI / 360.0) * (zFar / z));
 		float m_transY = (float)(ASPECT_RATIO * yrel / (float)(DISPLAY_WIDTH)* zNear * 2.0 * tan(fovy * M_PI / 360.0) * (zFar / z));
 
@@ -106,6 +106,20 @@ void InputHandler::keyCallback(GLFWwindow* window, int key, int scancode, int ac
 			m_IKSolver->spacePressed();
 		}
 		break;
+
+	case GLFW_KEY_F:
+		if (action == GLFW_PRESS)
+		{
+			m_IKSolver->toggleSolverType();
+		}
+		break;
+
+	case GLFW_KEY_P:
+		if (action == GLFW_PRESS)
+		{
+			m_IKSolver->togglePickingMode();
+		}
+		break;
 	}
 }
 
@@ -116,9 +130,7 @@ void InputHandler::mouseCallback(GLFWwindow* window, int button, int action, int
 
 	if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) || glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) || glfwSetScrollCallback(window, scrollCallbackStatic)) {
 		
-		m_depth;
-		glReadPixels(xpos, DISPLAY_HEIGHT - ypos - 1, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &m_depth);
-		
+		// The pressed object and its depth come from the solver's picking, nothing is read back from the GPU here.
 		m_IKSolver->handleMouseCallback((float)xpos, (float)ypos);
 	}
 }
@@ -31,7 +31,5 @@ class InputHandler
 		
 		float m_currentX;
 		float m_currentY;
-
-		float m_depth;
 };
 
@@ -0,0 +1,253 @@
+#include "PickingBVH.h"
+#include <algorithm>
+#include <cmath>
+
+/*
+* PickingBVH
+*
+* @tparam capacity The maximal number of boxes, a hierarchy of n boxes has at most 2n - 1 nodes.
+*/
+PickingBVH::PickingBVH(int capacity)
+{
+	m_boxes.resize(capacity);
+	m_order.resize(capacity);
+	m_nodes.resize(std::max(1, 2 * capacity - 1));
+	m_numOfBoxes = 0;
+	m_numOfNodes = 0;
+}
+
+/*
+* build
+*
+* @tbrief Build the hierarchy for the boxes' current transformations, O(n log n). Once built, refit follows the boxes as they move.
+* @tparam transformations Every box's rigid world transformation, the box is centered on its origin.
+* @tparam sizes Every box's size along its own axes.
+* @tparam numOfBoxes Number of boxes, at most the capacity, a box's index is its index in the arrays.
+*/
+void PickingBVH::build(const mat4* transformations, const vec3* sizes, int numOfBoxes)
+{
+	m_numOfBoxes = std::min(numOfBoxes, (int)m_boxes.size());
+	m_numOfNodes = 0;
+	for (int i = 0; i < m_numOfBoxes; i++)
+	{
+		m_boxes[i].halfSize = sizes[i] / 2.0f;
+		updateBox(m_boxes[i], transformations[i]);
+		m_order[i] = i;
+	}
+
+	if (m_numOfBoxes > 0)
+	{
+		buildNode(0, m_numOfBoxes);
+	}
+}
+
+/*
+* refit
+*
+* @tbrief Move the built boxes to their new transformations and recalculate the nodes' bounds, O(n). The hierarchy's
+* splits are kept, which stays tight while the boxes move coherently, like the links of a chain, build again when they don't.
+* @tparam transformations Every box's rigid world transformation, indexed like the transformations it was built with.
+*/
+void PickingBVH::refit(const mat4* transformations)
+{
+	for (int i = 0; i < m_numOfBoxes; i++)
+	{
+		updateBox(m_boxes[i], transformations[i]);
+	}
+
+	// Children are always built after their parent, so going back from the last node every node's children are already refitted.
+	for (int nodeIndex = m_numOfNodes - 1; nodeIndex >= 0; nodeIndex--)
+	{
+		Node& node = m_nodes[nodeIndex];
+		if (node.count > 0)
+		{
+			node.boundsMin = vec3(INFINITY);
+			node.boundsMax = vec3(-INFINITY);
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				node.boundsMin = min(node.boundsMin, m_boxes[m_order[i]].boundsMin);
+				node.boundsMax = max(node.boundsMax, m_boxes[m_order[i]].boundsMax);
+			}
+		}
+		else
+		{
+			node.boundsMin = min(m_nodes[node.left].boundsMin, m_nodes[node.right].boundsMin);
+			node.boundsMax = max(m_nodes[node.left].boundsMax, m_nodes[node.right].boundsMax);
+		}
+	}
+}
+
+/*
+* updateBox
+*
+* @tbrief Calculate a box's world to box transformation and world bounds from its transformation, its half size is kept.
+*/
+void PickingBVH::updateBox(Box& box, const mat4& transformation)
+{
+	// The transformations are rigid, so the inverse rotation is the transpose.
+	mat3 boxToWorldRotation = mat3(transformation);
+	mat3 worldToBoxRotation = transpose(boxToWorldRotation);
+	box.worldToBox = mat4(worldToBoxRotation);
+	box.worldToBox[3] = vec4(-(worldToBoxRotation * vec3(transformation[3])), 1.0f);
+
+	// The world bounds of the box, every axis' extent is the sum of the box's rotated half axes on it.
+	vec3 center = vec3(transformation[3]);
+	vec3 extent = abs(vec3(transformation[0])) * box.halfSize.x + abs(vec3(transformation[1])) * box.halfSize.y +
+		abs(vec3(transformation[2])) * box.halfSize.z;
+	box.boundsMin = center - extent;
+	box.boundsMax = center + extent;
+	box.center = center;
+}
+
+/*
+* buildNode
+*
+* @tbrief Build the node of the boxes m_order[first .. first + count) and its children.
+* @treturn The node's index.
+*/
+int PickingBVH::buildNode(int first, int count)
+{
+	int nodeIndex = m_numOfNodes++;
+	Node& node = m_nodes[nodeIndex];
+	node.boundsMin = vec3(INFINITY);
+	node.boundsMax = vec3(-INFINITY);
+	vec3 centersMin = vec3(INFINITY);
+	vec3 centersMax = vec3(-INFINITY);
+	for (int i = first; i < first + count; i++)
+	{
+		const Box& box = m_boxes[m_order[i]];
+		node.boundsMin = min(node.boundsMin, box.boundsMin);
+		node.boundsMax = max(node.boundsMax, box.boundsMax);
+		centersMin = min(centersMin, box.center);
+		centersMax = max(centersMax, box.center);
+	}
+
+	if (count <= PICKING_BVH_LEAF_SIZE)
+	{
+		node.first = first;
+		node.count = count;
+		return nodeIndex;
+	}
+
+	// Split the boxes in half at the median of their centers along the axis the centers spread the most on.
+	vec3 spread = centersMax - centersMin;
+	int axis = (spread.x > spread.y) ? ((spread.x > spread.z) ? 0 : 2) : ((spread.y > spread.z) ? 1 : 2);
+	int half = count / 2;
+	std::nth_element(m_order.begin() + first, m_order.begin() + first + half, m_order.begin() + first + count,
+		[this, axis](int a, int b) { return m_boxes[a].center[axis] < m_boxes[b].center[axis]; });
+
+	node.first = first;
+	node.count = 0;
+	node.left = buildNode(first, half);
+	node.right = buildNode(first + half, count - half);
+	return nodeIndex;
+}
+
+/*
+* raycast
+*
+* @tbrief The nearest box the ray hits, the nodes are visited nearest first and skipped once they're behind the nearest hit.
+* @tparam origin The ray's origin.
+* @tparam direction The ray's direction, distances are measured in its length.
+* @tparam hitDistance Set to the distance along the ray to the hit, the hit point is origin + hitDistance * direction.
+* @treturn The index of the box that was hit, -1 if the ray misses all the boxes.
+*/
+int PickingBVH::raycast(vec3 origin, vec3 direction, float& hitDistance)
+{
+	int hitIndex = -1;
+	hitDistance = INFINITY;
+	if (m_numOfBoxes == 0)
+	{
+		return hitIndex;
+	}
+
+	vec3 inverseDirection = 1.0f / direction;
+	int stack[PICKING_BVH_MAX_DEPTH];
+	int stackSize = 0;
+	float distance;
+	if (rayHitsBounds(origin, inverseDirection, m_nodes[0].boundsMin, m_nodes[0].boundsMax, hitDistance, distance))
+	{
+		stack[stackSize++] = 0;
+	}
+
+	while (stackSize > 0)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+		if (node.count > 0)
+		{
+			for (int i = node.first; i < node.first + node.count; i++)
+			{
+				if (rayHitsBox(m_boxes[m_order[i]], origin, direction, hitDistance, distance))
+				{
+					hitDistance = distance;
+					hitIndex = m_order[i];
+				}
+			}
+			continue;
+		}
+
+		// Push the farther child first so the nearer one is visited first and can cut the farther one off.
+		float leftDistance, rightDistance;
+		const Node& left = m_nodes[node.left];
+		const Node& right = m_nodes[node.right];
+		bool hitsLeft = rayHitsBounds(origin, inverseDirection, left.boundsMin, left.boundsMax, hitDistance, leftDistance);
+		bool hitsRight = rayHitsBounds(origin, inverseDirection, right.boundsMin, right.boundsMax, hitDistance, rightDistance);
+		if (hitsLeft && hitsRight)
+		{
+			bool isLeftNearer = leftDistance <= rightDistance;
+			stack[stackSize++] = isLeftNearer ? node.right : node.left;
+			stack[stackSize++] = isLeftNearer ? node.left : node.right;
+		}
+		else if (hitsLeft || hitsRight)
+		{
+			stack[stackSize++] = hitsLeft ? node.left : node.right;
+		}
+	}
+	return hitIndex;
+}
+
+/*
+* rayHitsBounds
+*
+* @tbrief Slab test of the ray against axis aligned bounds. An axis the ray is parallel to (an infinite inverse direction)
+* is tested by the origin alone, as 0 * infinity would be NaN for an origin on one of its planes.
+* @tparam distance Set to the distance along the ray where it enters the bounds, 0 if it starts inside them.
+* @treturn true if the ray enters the bounds before maxDistance.
+*/
+bool PickingBVH::rayHitsBounds(vec3 origin, vec3 inverseDirection, vec3 boundsMin, vec3 boundsMax, float maxDistance, float& distance)
+{
+	float enter = 0.0f;
+	float exit = INFINITY;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (std::isinf(inverseDirection[axis]))
+		{
+			if ((origin[axis] < boundsMin[axis]) || (origin[axis] > boundsMax[axis]))
+			{
+				return false;
+			}
+			continue;
+		}
+
+		float t0 = (boundsMin[axis] - origin[axis]) * inverseDirection[axis];
+		float t1 = (boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+		enter = std::max(enter, std::min(t0, t1));
+		exit = std::min(exit, std::max(t0, t1));
+	}
+	distance = enter;
+	return (enter <= exit) && (enter < maxDistance);
+}
+
+/*
+* rayHitsBox
+*
+* @tbrief Test the ray against an oriented box, in the box's coordinates where it's axis aligned. The box's transformation
+* is rigid, so the distance along the transformed ray is the same as along the world ray.
+* @treturn true if the ray enters the box before maxDistance.
+*/
+bool PickingBVH::rayHitsBox(const Box& box, vec3 origin, vec3 direction, float maxDistance, float& distance)
+{
+	vec3 boxOrigin = vec3(box.worldToBox * vec4(origin, 1.0f));
+	vec3 boxDirection = vec3(box.worldToBox * vec4(direction, 0.0f));
+	return rayHitsBounds(boxOrigin, 1.0f / boxDirection, -box.halfSize, box.halfSize, maxDistance, distance);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "glm\glm.hpp"
+#include <vector>
+
+using namespace glm;
+
+// Most boxes in a leaf, and the deepest the hierarchy gets (a median split halves the boxes every level).
+static const int PICKING_BVH_LEAF_SIZE = 4;
+static const int PICKING_BVH_MAX_DEPTH = 64;
+
+/*
+* PickingBVH
+*
+* Ray picking against oriented boxes on the CPU, instead of rendering the scene with picking colors and reading it back.
+* Every box is a cube of a given size around the origin of its rigid world transformation. The boxes' world bounds are
+* kept in a bounding volume hierarchy, split at the median of the longest axis, so a ray only visits the boxes whose
+* bounds it crosses, O(log n) for a scene of thousands of boxes. The nodes are allocated once, for the given capacity,
+* the hierarchy is built once and refitted to the boxes' new transformations in O(n) as they move.
+*/
+class PickingBVH
+{
+	public:
+		PickingBVH(int capacity);
+
+		void build(const mat4* transformations, const vec3* sizes, int numOfBoxes);
+		void refit(const mat4* transformations);
+		int raycast(vec3 origin, vec3 direction, float& hitDistance);
+
+	private:
+		// A node's bounds and either its two children (count == 0) or its boxes, m_order[first .. first + count).
+		struct Node
+		{
+			vec3 boundsMin, boundsMax;
+			int first, count;
+			int left, right;
+		};
+
+		// A box's world to box transformation, half its size and the middle of its world bounds.
+		struct Box
+		{
+			mat4 worldToBox;
+			vec3 halfSize;
+			vec3 boundsMin, boundsMax;
+			vec3 center;
+		};
+
+		int buildNode(int first, int count);
+		void updateBox(Box& box, const mat4& transformation);
+		bool rayHitsBounds(vec3 origin, vec3 inverseDirection, vec3 boundsMin, vec3 boundsMax, float maxDistance, float& distance);
+		bool rayHitsBox(const Box& box, vec3 origin, vec3 direction, float maxDistance, float& distance);
+
+		std::vector<Box> m_boxes;
+		std::vector<int> m_order;
+		std::vector<Node> m_nodes;
+		int m_numOfBoxes;
+		int m_numOfNodes;
+};
@@ -5,6 +5,8 @@
 
 Display::Display()
 {
+	error = 0;
+
 	/* Initialize the library */
     if (!glfwInit())
         error =  -1;
@@ -22,7 +24,14 @@ Display::Display()
     if(res != GLEW_OK)
    {
 		std::cerr << "Glew failed to initialize!" << std::endl;
+		error = -1;
     }
+	// The shaders are GLSL 1.40 reading uniform blocks (GL 3.1), and the meshes' normals are packed 10-10-10-2 (GL 3.3 or its extension).
+	else if (!GLEW_VERSION_3_1 || !(GLEW_VERSION_3_3 || GLEW_ARB_vertex_type_2_10_10_10_rev))
+	{
+		std::cerr << "OpenGL 3.1 with ARB_vertex_type_2_10_10_10_rev is required, the context is OpenGL " << glGetString(GL_VERSION) << std::endl;
+		error = -1;
+	}
 
 	glEnable(GL_DEPTH_TEST);
 
@@ -1,14 +1,31 @@
 ﻿
 #include <Windows.h>
+#include <stdlib.h>
 #include "IKSolver.h"
 #include "InputHandler.h"
 
 int main(int argc, char** argv)
 {
 	Display display;
-	IKSolver iKSolver;
+	if (display.error)
+	{
+		return 1;
+	}
+
+	// The number of links in the chain can be given as the first argument.
+	IKSolver iKSolver(argc > 1 ? atoi(argv[1]) : DEFAULT_NUM_OF_LINKS);
 	InputHandler* inputHandler = InputHandler::getInstance(display.m_window, &iKSolver);
 
+	// Buffers created while loading the scene are not counted as per frame allocations.
+	unsigned int lastBufferAllocations = 0;
+	unsigned int lastUniformUploads = 0;
+	unsigned int lastDraws = 0;
+	unsigned int lastStateChanges = 0;
+	Mesh::ResetBufferAllocations();
+	UniformBuffers::ResetUniformUploads();
+	RenderQueue::ResetDraws();
+	GLStateCache::ResetStateChanges();
+
 	// Draw loop.
 	while (!glfwWindowShouldClose(display.m_window))
 	{
@@ -16,6 +33,37 @@ int main(int argc, char** argv)
 		display.Clear(1.0f, 1.0f, 1.0f, 1.0f);
 
 		iKSolver.draw();
+
+		// Report the number of GPU buffers allocated during this frame whenever it changes, 0 in steady state.
+		unsigned int bufferAllocations = Mesh::GetBufferAllocations();
+		if (bufferAllocations != lastBufferAllocations)
+		{
+			std::cout << "Buffer allocations per frame: " << bufferAllocations << std::endl;
+			lastBufferAllocations = bufferAllocations;
+		}
+		Mesh::ResetBufferAllocations();
+
+		// Report the number of uniform uploads during this frame whenever it changes, 2 buffer updates for a drawn frame.
+		unsigned int uniformUploads = UniformBuffers::GetUniformUploads();
+		if (uniformUploads != lastUniformUploads)
+		{
+			std::cout << "Uniform uploads per frame: " << uniformUploads << std::endl;
+			lastUniformUploads = uniformUploads;
+		}
+		UniformBuffers::ResetUniformUploads();
+
+		// Report the number of draw calls and GL state changes during this frame whenever they change.
+		unsigned int draws = RenderQueue::GetDraws();
+		unsigned int stateChanges = GLStateCache::GetStateChanges();
+		if (draws != lastDraws || stateChanges != lastStateChanges)
+		{
+			std::cout << "Draws per frame: " << draws << ", state changes: " << stateChanges <<
+				" (" << GLStateCache::GetSkippedStateChanges() << " redundant skipped)" << std::endl;
+			lastDraws = draws;
+			lastStateChanges = stateChanges;
+		}
+		RenderQueue::ResetDraws();
+		GLStateCache::ResetStateChanges();
 		
 		display.SwapBuffers();
 		glfwPollEvents();
@@ -1,21 +1,38 @@
-#version 120
+#version 140
 
-attribute vec3 position;
-attribute vec2 texCoord;
-attribute vec3 normal;
-attribute vec3 color;
+in vec3 position;
+in vec2 texCoord;
+in vec3 normal;
+in vec3 color;
 
-varying vec2 texCoord0;
-varying vec3 normal0;
-varying vec3 color0;
+out vec2 texCoord0;
+out vec3 normal0;
+out vec3 color0;
 
-uniform mat4 MVP;
-uniform mat4 Normal;
+// The frame's constants and the objects of this draw, filled by UniformBuffers, the array's size is UNIFORM_OBJECTS_PER_DRAW.
+layout(std140) uniform Frame
+{
+	mat4 viewProjection;
+	vec4 lightDirection;
+	vec4 lightColor;
+};
+
+struct Object
+{
+	mat4 model;
+	vec4 pickingColor;
+};
+
+layout(std140) uniform Objects
+{
+	Object objects[128];
+};
 
 void main()
 {
-	gl_Position = MVP * vec4(position, 1.0);
+	mat4 model = objects[gl_InstanceID].model;
+	gl_Position = viewProjection * model * vec4(position, 1.0);
 	texCoord0 = texCoord;
 	color0 = color;
-	normal0 = (Normal * vec4(normal, 0.0)).xyz;
+	normal0 = (model * vec4(normal, 0.0)).xyz;
 }
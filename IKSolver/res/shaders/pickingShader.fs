@@ -1,18 +1,10 @@
-#version 130
+#version 140
 
-varying vec2 texCoord0;
-varying vec3 normal0;
-varying vec3 color0;
-
-uniform vec3 lightDirection;
-uniform vec3 lightColor;
-uniform vec4 picking_color;
+flat in vec4 pickingColor0;
 
+out vec4 fragColor;
 
 void main()
 {
-
-		gl_FragColor =  picking_color;
-
-
+	fragColor = pickingColor0;
 }
@@ -1,14 +1,19 @@
 #define GLEW_STATIC
 #include <GL\glew.h>
 #include "mesh.h"
+#include "glm\gtc\packing.hpp"
 #include <map>
 #include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <stdlib.h>
+#include <stddef.h>
+
+unsigned int Mesh::s_bufferAllocations = 0;
 
 Mesh::Mesh(const std::string& fileName)
 {
+	m_primitive = GL_TRIANGLES;
     InitMesh(OBJModel(fileName).ToIndexedModel());
 }
 
@@ -16,40 +21,57 @@ void Mesh::InitMesh(const IndexedModel& model)
 {
     m_numIndices = model.indices.size();
 
+	// Interleave and pack the model's attributes, a vertex without a texture coordinate, normal or color gets zeros.
+	std::vector<PackedVertex> vertices(model.positions.size());
+	for (unsigned int i = 0; i < vertices.size(); i++)
+	{
+		glm::vec2 texCoord = (i < model.texCoords.size()) ? model.texCoords[i] : glm::vec2(0.0f);
+		glm::vec3 normal = (i < model.normals.size()) ? model.normals[i] : glm::vec3(0.0f);
+		glm::vec3 color = (i < model.colors.size()) ? model.colors[i] : glm::vec3(0.0f);
+		vertices[i].pos = model.positions[i];
+		vertices[i].texCoord = glm::packHalf2x16(texCoord);
+		vertices[i].normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+		vertices[i].color = glm::packUnorm4x8(glm::vec4(color, 1.0f));
+	}
+
     glGenVertexArrays(1, &m_vertexArrayObject);
 	glBindVertexArray(m_vertexArrayObject);
 
 	glGenBuffers(NUM_BUFFERS, m_vertexArrayBuffers);
-	
-	glBindBuffer(GL_ARRAY_BUFFER, m_vertexArrayBuffers[POSITION_VB]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(model.positions[0]) * model.positions.size(), &model.positions[0], GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	glBindBuffer(GL_ARRAY_BUFFER, m_vertexArrayBuffers[TEXCOORD_VB]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(model.texCoords[0]) * model.texCoords.size(), &model.texCoords[0], GL_STATIC_DRAW);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
-	glBindBuffer(GL_ARRAY_BUFFER, m_vertexArrayBuffers[NORMAL_VB]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(model.normals[0]) * model.normals.size(), &model.normals[0], GL_STATIC_DRAW);
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-	glBindBuffer(GL_ARRAY_BUFFER, m_vertexArrayBuffers[COLOR_VB]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(model.colors[0]) * model.colors.size(), &model.colors[0], GL_STATIC_DRAW);
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
+	s_bufferAllocations += NUM_BUFFERS;
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexArrayBuffers[VERTEX_VB]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(PackedVertex) * vertices.size(), vertices.empty() ? NULL : &vertices[0], GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, pos));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoord));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, color));
+
+	// 16 bit indices halve the index buffer whenever the mesh has at most 65536 vertices.
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vertexArrayBuffers[INDEX_VB]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(model.indices[0]) * model.indices.size(), &model.indices[0], GL_STATIC_DRAW);
+	if (vertices.size() <= 65536)
+	{
+		std::vector<unsigned short> shortIndices(model.indices.begin(), model.indices.end());
+		m_indexType = GL_UNSIGNED_SHORT;
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned short) * shortIndices.size(), shortIndices.empty() ? NULL : &shortIndices[0], GL_STATIC_DRAW);
+	}
+	else
+	{
+		m_indexType = GL_UNSIGNED_INT;
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * model.indices.size(), &model.indices[0], GL_STATIC_DRAW);
+	}
 
 	glBindVertexArray(0);
 }
 
-Mesh::Mesh(Vertex* vertices, unsigned int numVertices, unsigned int* indices, unsigned int numIndices)
+Mesh::Mesh(Vertex* vertices, unsigned int numVertices, unsigned int* indices, unsigned int numIndices, MeshPrimitive primitive)
 {
     IndexedModel model;
+	m_primitive = (primitive == MESH_LINES) ? GL_LINES : GL_TRIANGLES;
 
 	for(unsigned int i = 0; i < numVertices; i++)
 	{
@@ -73,10 +95,29 @@ Mesh::~Mesh()
 
 void Mesh::Draw()
 {
-	glBindVertexArray(m_vertexArrayObject);
-
-	//glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, 0);
-	glDrawElementsBaseVertex(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, 0, 0);
+	DrawInstanced(1);
+}
 
+/*
+* DrawInstanced
+*
+* @tbrief Draw numInstances copies of the mesh in a single draw call, the shader places every copy by its gl_InstanceID.
+* @tparam numInstances Number of instances to draw.
+*/
+void Mesh::DrawInstanced(unsigned int numInstances)
+{
+	glBindVertexArray(m_vertexArrayObject);
+	DrawBound(numInstances);
 	glBindVertexArray(0);
 }
+
+/*
+* DrawBound
+*
+* @tbrief Draw numInstances copies of the mesh, with its vertex array already bound by the caller.
+* @tparam numInstances Number of instances to draw.
+*/
+void Mesh::DrawBound(unsigned int numInstances)
+{
+	glDrawElementsInstanced(m_primitive, m_numIndices, m_indexType, 0, numInstances);
+}
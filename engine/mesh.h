@@ -29,27 +29,51 @@ private:
 	glm::vec3 color;
 };
 
+// The vertex layout uploaded to the GPU, all the attributes interleaved in one buffer and packed to 24 bytes
+// (the float attributes take 44): half float texture coordinates, a 10-10-10-2 signed normalized normal
+// and an 8 bit per channel color, the shaders read them back as floats.
+struct PackedVertex
+{
+	glm::vec3 pos;
+	unsigned int texCoord;
+	unsigned int normal;
+	unsigned int color;
+};
+
 enum MeshBufferPositions
 {
-	POSITION_VB,
-	TEXCOORD_VB,
-	NORMAL_VB,
-	INDEX_VB,
-	COLOR_VB
+	VERTEX_VB,
+	INDEX_VB
+};
+
+// What every 3 or 2 indices of a mesh draw.
+enum MeshPrimitive
+{
+	MESH_TRIANGLES,
+	MESH_LINES
 };
 
 class Mesh
 {
 public:
     Mesh(const std::string& fileName);
-	Mesh(Vertex* vertices, unsigned int numVertices, unsigned int* indices, unsigned int numIndices);
+	Mesh(Vertex* vertices, unsigned int numVertices, unsigned int* indices, unsigned int numIndices, MeshPrimitive primitive = MESH_TRIANGLES);
 
 	void Draw();
+	void DrawInstanced(unsigned int numInstances);
+	void DrawBound(unsigned int numInstances);
+	unsigned int GetVertexArray() { return m_vertexArrayObject; }
+
+	// Number of GPU buffers generated since the last reset, used to verify no buffers are created per frame.
+	static unsigned int GetBufferAllocations() { return s_bufferAllocations; }
+	static void ResetBufferAllocations() { s_bufferAllocations = 0; }
 
 	virtual ~Mesh();
 protected:
 private:
-	static const unsigned int NUM_BUFFERS = 5;
+	static const unsigned int NUM_BUFFERS = 2;
+	static unsigned int s_bufferAllocations;
+
 	void operator=(const Mesh& mesh) {}
 	Mesh(const Mesh& mesh) {}
 
@@ -58,6 +82,12 @@ private:
 	unsigned int m_vertexArrayObject;
 	unsigned int m_vertexArrayBuffers[NUM_BUFFERS];
 	unsigned int m_numIndices;
+
+	// GL_UNSIGNED_SHORT when every vertex can be indexed with 16 bits, GL_UNSIGNED_INT otherwise.
+	unsigned int m_indexType;
+
+	// GL_TRIANGLES or GL_LINES.
+	unsigned int m_primitive;
 };
 
 #endif
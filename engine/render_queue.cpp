@@ -0,0 +1,138 @@
+#define GLEW_STATIC
+#include <GL\glew.h>
+#include "render_queue.h"
+#include <algorithm>
+
+unsigned int GLStateCache::s_stateChanges = 0;
+unsigned int GLStateCache::s_skippedStateChanges = 0;
+unsigned int RenderQueue::s_draws = 0;
+
+GLStateCache::GLStateCache()
+{
+	Invalidate();
+}
+
+/*
+* Invalidate
+*
+* @tbrief Forget the bound state, the next bind of every kind is issued whatever it binds.
+*/
+void GLStateCache::Invalidate()
+{
+	m_program = GL_STATE_UNKNOWN;
+	m_texture = GL_STATE_UNKNOWN;
+	m_vertexArray = GL_STATE_UNKNOWN;
+}
+
+void GLStateCache::UseProgram(unsigned int program)
+{
+	if (m_program == program)
+	{
+		s_skippedStateChanges++;
+		return;
+	}
+	glUseProgram(program);
+	m_program = program;
+	s_stateChanges++;
+}
+
+void GLStateCache::BindTexture(unsigned int texture)
+{
+	if (m_texture == texture)
+	{
+		s_skippedStateChanges++;
+		return;
+	}
+
+	// Every texture is bound to unit 0, the one all the samplers read.
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	m_texture = texture;
+	s_stateChanges++;
+}
+
+void GLStateCache::BindVertexArray(unsigned int vertexArray)
+{
+	if (m_vertexArray == vertexArray)
+	{
+		s_skippedStateChanges++;
+		return;
+	}
+	glBindVertexArray(vertexArray);
+	m_vertexArray = vertexArray;
+	s_stateChanges++;
+}
+
+/*
+* RenderQueue
+*
+* @tparam capacity The number of draws a frame usually queues, more only cost a reallocation.
+*/
+RenderQueue::RenderQueue(unsigned int capacity)
+{
+	m_items.reserve(capacity);
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+/*
+* Add
+*
+* @tbrief Queue a draw, nothing is bound or drawn until Execute.
+* @tparam shader The shader the objects are drawn with.
+* @tparam texture The texture bound to unit 0, 0 for none.
+* @tparam mesh The mesh every object is drawn with.
+* @tparam firstObject The first object's index, returned by UniformBuffers::AddObjects.
+* @tparam numObjects Number of objects to draw.
+*/
+void RenderQueue::Add(Shader* shader, unsigned int texture, Mesh* mesh, unsigned int firstObject, unsigned int numObjects)
+{
+	DrawItem item = { shader, texture, mesh, firstObject, numObjects };
+	m_items.push_back(item);
+}
+
+/*
+* Execute
+*
+* @tbrief Sort the queued draws by program, texture and mesh, draw them and empty the queue.
+* The state bound before is unknown to the cache, so the first binds are always issued.
+* @tparam uniforms The uniform buffers the draws' objects were added to, already uploaded.
+*/
+void RenderQueue::Execute(UniformBuffers* uniforms)
+{
+	// Draws that share a key keep the order they were queued in.
+	std::stable_sort(m_items.begin(), m_items.end(), [](const DrawItem& a, const DrawItem& b)
+	{
+		if (a.shader->GetProgram() != b.shader->GetProgram())
+			return a.shader->GetProgram() < b.shader->GetProgram();
+		if (a.texture != b.texture)
+			return a.texture < b.texture;
+		return a.mesh->GetVertexArray() < b.mesh->GetVertexArray();
+	});
+
+	m_state.Invalidate();
+	for (unsigned int i = 0; i < m_items.size(); i++)
+	{
+		const DrawItem& item = m_items[i];
+		BindState(item.shader, item.texture, item.mesh->GetVertexArray());
+		s_draws += uniforms->DrawObjects(*item.mesh, item.firstObject, item.numObjects);
+	}
+	m_items.clear();
+}
+
+/*
+* BindState
+*
+* @tbrief Bind a program, texture and vertex array through the cache, for drawing outside the queue after an Execute.
+* @tparam shader The shader to use.
+* @tparam texture The texture to bind to unit 0, 0 for none.
+* @tparam vertexArray The vertex array to bind, 0 for none.
+*/
+void RenderQueue::BindState(Shader* shader, unsigned int texture, unsigned int vertexArray)
+{
+	m_state.UseProgram(shader->GetProgram());
+	m_state.BindTexture(texture);
+	m_state.BindVertexArray(vertexArray);
+}
@@ -0,0 +1,85 @@
+#ifndef RENDER_QUEUE_INCLUDED_H
+#define RENDER_QUEUE_INCLUDED_H
+
+#include <vector>
+#include "mesh.h"
+#include "shader.h"
+#include "uniform_buffers.h"
+
+// Not the name of any GL object, what the cache holds for state it doesn't know.
+static const unsigned int GL_STATE_UNKNOWN = 0xffffffff;
+
+// A queued draw, the objects [firstObject, firstObject + numObjects) of the uniform buffers drawn with the mesh.
+struct DrawItem
+{
+	Shader* shader;
+	unsigned int texture;
+	Mesh* mesh;
+	unsigned int firstObject;
+	unsigned int numObjects;
+};
+
+/*
+* GLStateCache
+*
+* The program, texture and vertex array currently bound, a bind of what's already bound is skipped.
+* Anything bound behind the cache's back makes it stale, Invalidate forgets it so the next binds are issued.
+*/
+class GLStateCache
+{
+public:
+	GLStateCache();
+
+	void Invalidate();
+	void UseProgram(unsigned int program);
+	void BindTexture(unsigned int texture);
+	void BindVertexArray(unsigned int vertexArray);
+
+	// Number of binds issued and skipped as redundant since the last reset.
+	static unsigned int GetStateChanges() { return s_stateChanges; }
+	static unsigned int GetSkippedStateChanges() { return s_skippedStateChanges; }
+	static void ResetStateChanges() { s_stateChanges = 0; s_skippedStateChanges = 0; }
+
+private:
+	static unsigned int s_stateChanges;
+	static unsigned int s_skippedStateChanges;
+
+	// The bound names, GL_STATE_UNKNOWN when the cache doesn't know what's bound.
+	unsigned int m_program;
+	unsigned int m_texture;
+	unsigned int m_vertexArray;
+};
+
+/*
+* RenderQueue
+*
+* Collects the frame's draws and issues them sorted by program, then texture, then mesh, so every run of draws
+* that share a program or a texture binds it once. The binds go through a GLStateCache.
+*/
+class RenderQueue
+{
+public:
+	RenderQueue(unsigned int capacity);
+
+	void Add(Shader* shader, unsigned int texture, Mesh* mesh, unsigned int firstObject, unsigned int numObjects);
+	void Execute(UniformBuffers* uniforms);
+	void BindState(Shader* shader, unsigned int texture, unsigned int vertexArray);
+
+	// Number of draw calls issued since the last reset.
+	static unsigned int GetDraws() { return s_draws; }
+	static void ResetDraws() { s_draws = 0; }
+
+	virtual ~RenderQueue();
+protected:
+private:
+	static unsigned int s_draws;
+
+	void operator=(const RenderQueue& renderQueue) {}
+	RenderQueue(const RenderQueue& renderQueue) {}
+
+	// The queued draws, reserved at construction and emptied by every Execute.
+	std::vector<DrawItem> m_items;
+	GLStateCache m_state;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #define GLEW_STATIC
 #include <GL\glew.h>
 #include "shader.h"
+#include "uniform_buffers.h"
 #include <iostream>
 #include <fstream>
 
@@ -20,6 +21,7 @@ Shader::Shader(const std::string& fileName)
 	glBindAttribLocation(m_program, 1, "texCoord");
 	glBindAttribLocation(m_program, 2, "normal");
 	glBindAttribLocation(m_program, 3, "color");
+	glBindFragDataLocation(m_program, 0, "fragColor");
 
 
 	glLinkProgram(m_program);
@@ -28,12 +30,18 @@ Shader::Shader(const std::string& fileName)
 	glValidateProgram(m_program);
 	CheckShaderError(m_program, GL_LINK_STATUS, true, "Invalid shader program");
 
-	m_uniforms[0] = glGetUniformLocation(m_program, "MVP");
-	m_uniforms[1] = glGetUniformLocation(m_program, "Normal");
-	m_uniforms[2] = glGetUniformLocation(m_program, "lightDirection");
-	m_uniforms[3] = glGetUniformLocation(m_program, "lightColor");
-	m_uniforms[4] = glGetUniformLocation(m_program, "picking_color");
-	m_uniforms[5] = glGetUniformLocation(m_program, "texture0");
+	// The matrices and the light come from the shared uniform buffers, a shader only says which blocks it reads.
+	GLuint frameBlock = glGetUniformBlockIndex(m_program, "Frame");
+	if (frameBlock != GL_INVALID_INDEX)
+		glUniformBlockBinding(m_program, frameBlock, FRAME_UNIFORMS_BINDING);
+	GLuint objectsBlock = glGetUniformBlockIndex(m_program, "Objects");
+	if (objectsBlock != GL_INVALID_INDEX)
+		glUniformBlockBinding(m_program, objectsBlock, OBJECT_UNIFORMS_BINDING);
+
+	// The texture is always on unit 0, set the sampler once instead of on every bind.
+	glUseProgram(m_program);
+	glUniform1i(glGetUniformLocation(m_program, "texture0"), 0);
+	glUseProgram(0);
 }
 
 
@@ -58,7 +66,6 @@ void Shader::bindTexture(unsigned int index)
 	// Activate the texture unit first before binding texture.
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, index);
-	glUniform1i(m_uniforms[5], 0);
 }
 
 unsigned int Shader::Texture(char const *filename) {
@@ -91,25 +98,6 @@ unsigned int Shader::Texture(char const *filename) {
 	return texId;
 }
 
-void Shader::Update(glm::mat4 MVP, glm::mat4 Normal, int i)
-{
-	glUniformMatrix4fv(m_uniforms[0], 1, GL_FALSE, &MVP[0][0]);
-	glUniformMatrix4fv(m_uniforms[1], 1, GL_FALSE, &Normal[0][0]);
-	glUniform3f(m_uniforms[2], 0.0f, 0.0f, 1.0f);
-	glUniform3f(m_uniforms[3], 1.0f, 1.0f, 1.0f);
-
-	glUniformMatrix4fv(m_uniforms[4], 1, GL_FALSE, &MVP[0][0]);
-
-	// Convert "i", the integer mesh ID, into an RGB color
-	int r = (i & 0x000000FF) >> 0;
-	int g = (i & 0x0000FF00) >> 8;
-	int b = (i & 0x00FF0000) >> 16;
-
-	// OpenGL expects colors to be in [0,1], so divide by 255.
-	glUniform4f(m_uniforms[4], r / 255.0f, g / 255.0f, b / 255.0f, 1.0f);
-	/*Texture();*/
-}
-
 std::string Shader::LoadShader(const std::string& fileName)
 {
     std::ifstream file;
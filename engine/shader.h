@@ -12,14 +12,13 @@ public:
 
 	void Bind();
 	void bindTexture(unsigned int index);
-	void Update(glm::mat4 MVP, glm::mat4 Normal, int i = 0);
+	unsigned int GetProgram() { return m_program; }
 	unsigned int Texture(char const *filename);
 
 	virtual ~Shader();
 protected:
 private:
 	static const unsigned int NUM_SHADERS = 2;
-	static const unsigned int NUM_UNIFORMS = 6;
 	void operator=(const Shader& shader) {}
 	Shader(const Shader& shader) {}
 	
@@ -29,7 +28,6 @@ private:
 
 	unsigned int m_program;
 	unsigned int m_shaders[NUM_SHADERS];
-	unsigned int m_uniforms[NUM_UNIFORMS];
 };
 
 #endif
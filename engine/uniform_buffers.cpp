@@ -0,0 +1,156 @@
+#define GLEW_STATIC
+#include <GL\glew.h>
+#include "uniform_buffers.h"
+#include <algorithm>
+
+unsigned int UniformBuffers::s_uniformUploads = 0;
+
+UniformBuffers::UniformBuffers()
+{
+	m_numObjects = 0;
+
+	// The smallest number of objects whose size is a multiple of the offset alignment.
+	GLint offsetAlignment = 1;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+	unsigned int alignment = std::max(offsetAlignment, 1);
+	m_objectAlignment = 1;
+	while ((m_objectAlignment * sizeof(ObjectUniforms)) % alignment != 0)
+	{
+		m_objectAlignment++;
+	}
+	m_objectsPerDraw = std::max(UNIFORM_OBJECTS_PER_DRAW - UNIFORM_OBJECTS_PER_DRAW % m_objectAlignment, m_objectAlignment);
+
+	glGenBuffers(NUM_BUFFERS, m_buffers);
+
+	// The frame's block never moves, bind it once for every shader.
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffers[FRAME_UB]);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, m_buffers[FRAME_UB]);
+
+	// A bound range always covers the shaders' whole array, so the buffer holds a full draw past its last object.
+	m_objectCapacity = UNIFORM_OBJECTS_PER_DRAW;
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffers[OBJECTS_UB]);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(ObjectUniforms) * m_objectCapacity, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformBuffers::~UniformBuffers()
+{
+	glDeleteBuffers(NUM_BUFFERS, m_buffers);
+}
+
+/*
+* SetFrame
+*
+* @tbrief Set the constants of the frame, uploaded by the next Upload.
+* @tparam viewProjection The camera's projection and view, every object's model matrix is applied before it.
+* @tparam lightDirection The direction of the scene's light.
+* @tparam lightColor The color of the scene's light.
+*/
+void UniformBuffers::SetFrame(const glm::mat4& viewProjection, const glm::vec3& lightDirection, const glm::vec3& lightColor)
+{
+	m_frame.viewProjection = viewProjection;
+	m_frame.lightDirection = glm::vec4(lightDirection, 0.0f);
+	m_frame.lightColor = glm::vec4(lightColor, 1.0f);
+}
+
+/*
+* ClearObjects
+*
+* @tbrief Start a new frame's objects, the array's storage is kept.
+*/
+void UniformBuffers::ClearObjects()
+{
+	m_numObjects = 0;
+}
+
+/*
+* AddObjects
+*
+* @tbrief Append objects drawn together, the first one starts at an offset a draw can bind.
+* @tparam models Contiguous array of numObjects model matrices.
+* @tparam numObjects Number of objects.
+* @tparam firstPickingId The first object's picking ID, the rest are numbered after it, -1 is never picked.
+* @treturn The first object's index, to draw them with DrawObjects.
+*/
+unsigned int UniformBuffers::AddObjects(const glm::mat4* models, unsigned int numObjects, int firstPickingId)
+{
+	unsigned int firstObject = (m_numObjects + m_objectAlignment - 1) / m_objectAlignment * m_objectAlignment;
+	m_numObjects = firstObject + numObjects;
+	if (m_objects.size() < m_numObjects)
+	{
+		m_objects.resize(m_numObjects);
+	}
+
+	for (unsigned int i = 0; i < numObjects; i++)
+	{
+		// Convert the integer picking ID into an RGB color in [0, 1], -1 is the full white background.
+		int id = (firstPickingId == -1) ? -1 : firstPickingId + (int)i;
+		int r = (id & 0x000000FF) >> 0;
+		int g = (id & 0x0000FF00) >> 8;
+		int b = (id & 0x00FF0000) >> 16;
+
+		m_objects[firstObject + i].model = models[i];
+		m_objects[firstObject + i].pickingColor = glm::vec4(r / 255.0f, g / 255.0f, b / 255.0f, 1.0f);
+	}
+	return firstObject;
+}
+
+/*
+* Upload
+*
+* @tbrief Upload the frame's constants and all its objects, one buffer update each. The objects buffer's storage
+* only grows when the frame has more objects than ever before.
+*/
+void UniformBuffers::Upload()
+{
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffers[FRAME_UB]);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &m_frame);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffers[OBJECTS_UB]);
+	if (m_numObjects + UNIFORM_OBJECTS_PER_DRAW > m_objectCapacity)
+	{
+		m_objectCapacity = m_numObjects + UNIFORM_OBJECTS_PER_DRAW;
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(ObjectUniforms) * m_objectCapacity, NULL, GL_DYNAMIC_DRAW);
+	}
+	if (m_numObjects > 0)
+	{
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ObjectUniforms) * m_numObjects, &m_objects[0]);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	s_uniformUploads += 2;
+}
+
+/*
+* BindObjects
+*
+* @tbrief Bind the objects from firstObject on to the shaders' Objects block, instance i reads firstObject + i.
+* @tparam firstObject An index returned by AddObjects, or that plus a multiple of the objects a draw takes.
+*/
+void UniformBuffers::BindObjects(unsigned int firstObject)
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORMS_BINDING, m_buffers[OBJECTS_UB],
+		sizeof(ObjectUniforms) * firstObject, sizeof(ObjectUniforms) * UNIFORM_OBJECTS_PER_DRAW);
+}
+
+/*
+* DrawObjects
+*
+* @tbrief Draw an instance of the mesh for every object, in as few instanced draw calls as the block's size allows.
+* The mesh's vertex array must already be bound.
+* @tparam mesh The mesh every object is drawn with.
+* @tparam firstObject The first object's index, returned by AddObjects.
+* @tparam numObjects Number of objects to draw.
+* @treturn The number of draw calls issued.
+*/
+unsigned int UniformBuffers::DrawObjects(Mesh& mesh, unsigned int firstObject, unsigned int numObjects)
+{
+	unsigned int numDraws = 0;
+	for (unsigned int drawn = 0; drawn < numObjects; drawn += m_objectsPerDraw)
+	{
+		BindObjects(firstObject + drawn);
+		mesh.DrawBound(std::min(m_objectsPerDraw, numObjects - drawn));
+		numDraws++;
+	}
+	return numDraws;
+}
@@ -0,0 +1,84 @@
+#ifndef UNIFORM_BUFFERS_INCLUDED_H
+#define UNIFORM_BUFFERS_INCLUDED_H
+
+#include "glm\glm.hpp"
+#include <vector>
+#include "mesh.h"
+
+// Uniform block binding points, every shader's Frame block reads the first and its Objects block the second.
+static const unsigned int FRAME_UNIFORMS_BINDING = 0;
+static const unsigned int OBJECT_UNIFORMS_BINDING = 1;
+
+// Objects a single draw can see, the size of the shaders' objects array.
+// 128 objects of 80 bytes are 10KB, within the 16KB every implementation allows a uniform block.
+static const unsigned int UNIFORM_OBJECTS_PER_DRAW = 128;
+
+// The Frame block's std140 layout, constant for the whole frame.
+struct FrameUniforms
+{
+	glm::mat4 viewProjection;
+	glm::vec4 lightDirection;
+	glm::vec4 lightColor;
+};
+
+// An element of the Objects block's std140 array, the object's model matrix and its picking ID as a color.
+struct ObjectUniforms
+{
+	glm::mat4 model;
+	glm::vec4 pickingColor;
+};
+
+/*
+* UniformBuffers
+*
+* The frame's constants and every object's uniforms, kept in a contiguous array on the CPU and uploaded in two buffer
+* updates a frame, instead of a few glUniform calls for every object. A draw only binds the range of the objects
+* buffer its instances start at, and every instance reads its own element by gl_InstanceID.
+*/
+class UniformBuffers
+{
+public:
+	UniformBuffers();
+
+	void SetFrame(const glm::mat4& viewProjection, const glm::vec3& lightDirection, const glm::vec3& lightColor);
+	void ClearObjects();
+	unsigned int AddObjects(const glm::mat4* models, unsigned int numObjects, int firstPickingId);
+	void Upload();
+
+	void BindObjects(unsigned int firstObject);
+	unsigned int DrawObjects(Mesh& mesh, unsigned int firstObject, unsigned int numObjects);
+
+	// Number of uniform uploads (glUniform calls and uniform buffer updates) since the last reset.
+	static unsigned int GetUniformUploads() { return s_uniformUploads; }
+	static void ResetUniformUploads() { s_uniformUploads = 0; }
+
+	virtual ~UniformBuffers();
+protected:
+private:
+	enum UniformBufferPositions
+	{
+		FRAME_UB,
+		OBJECTS_UB
+	};
+
+	static const unsigned int NUM_BUFFERS = 2;
+	static unsigned int s_uniformUploads;
+
+	void operator=(const UniformBuffers& uniformBuffers) {}
+	UniformBuffers(const UniformBuffers& uniformBuffers) {}
+
+	unsigned int m_buffers[NUM_BUFFERS];
+	FrameUniforms m_frame;
+
+	// The objects of this frame, every AddObjects starts at a bindable offset so some elements are padding.
+	std::vector<ObjectUniforms> m_objects;
+	unsigned int m_numObjects;
+	unsigned int m_objectCapacity;
+
+	// A bound range must start at a multiple of the implementation's offset alignment, in objects,
+	// and the most objects a draw takes so the next draw starts at such a multiple as well.
+	unsigned int m_objectAlignment;
+	unsigned int m_objectsPerDraw;
+};
+
+#endif